@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "FishCommon.hpp"
+#include "Interpreter.hpp"
+#include "ScreenConvert.hpp"
+
+namespace fish {
+
+//Machines are stepped in blocks of this many, one per byte of an AVX2 register
+static constexpr uint32_t BATCH_BLOCK = 32;
+
+//CALL doesn't check SP, so every machine gets a stack entry for each value SP can hold and a
+//runaway CALL can't reach the next machine's stack
+static constexpr uint32_t BATCH_STACK_SIZE = 256;
+
+//Runs many machines in lockstep with every register kept as an array over the machines
+//(struct of arrays), so one vector instruction does the same thing to a whole block of them.
+//Each step, a block whose machines are all about to run the same register-only instruction
+//runs it with AVX2. Blocks that diverge, and instructions that touch memory, the screen, the
+//stack or the keys, run machine by machine through the interpreter's instruction functions.
+//
+//Every machine behaves like a Chip8 with cycle timers and idle skipping turned off, so states
+//move freely between the two and running either gives the same registers, memory, screen and
+//cycle counts.
+class BatchCore {
+private:
+
+    template<typename Q> void runBlock(uint32_t base, uint32_t num);
+    void runLane(uint32_t lane, uint32_t num);
+
+    uint32_t m_size;             //Number of machines
+    uint32_t m_lanes;            //m_size rounded up to a whole block, the extra lanes are never read back
+    uint32_t m_clock_rate;
+    QuirkProfile m_quirks;
+    SimdLevel m_level;
+
+    //Register r of machine i is at m_V[r * m_lanes + i], everything else is indexed by machine
+    std::vector<uint8_t>  m_V;
+    std::vector<uint16_t> m_I;
+    std::vector<uint16_t> m_PC;
+    std::vector<uint16_t> m_last_pc;
+    std::vector<uint8_t>  m_SP;
+    std::vector<uint8_t>  m_DT;
+    std::vector<uint8_t>  m_ST;
+    std::vector<uint64_t> m_RNG;
+    std::vector<uint32_t> m_timer_accum;
+    std::vector<uint64_t> m_cycles;
+    std::vector<uint64_t> m_idle_cycles;
+    std::vector<uint8_t>  m_waiting;     //Set by LD Vx, K with no key down, like Chip8's m_waiting_for_key
+
+    //Memory, screens and stacks stay one block per machine, only single machines touch them
+    std::vector<uint8_t>  m_mem;         //CHIP8_MEM_SIZE bytes per machine
+    std::vector<uint64_t> m_screen;      //CHIP8_SCREEN_HEIGHT rows per machine
+    std::vector<uint16_t> m_stack;       //BATCH_STACK_SIZE entries per machine, only the first CHIP8_STACK_MAX are saved
+    std::vector<std::array<bool, CHIP8_NUM_KEYS>> m_keys; //Unpacked at the start of every cycle call
+
+    Interpreter m_interpreter;
+
+public:
+
+    BatchCore(uint32_t size);
+    ~BatchCore();
+
+    uint32_t getSize() const;
+    void setClockRate(uint32_t hz);
+    uint32_t getClockRate() const;
+    void setQuirkProfile(QuirkProfile profile);
+    QuirkProfile getQuirkProfile() const;
+    void setSimdLevel(SimdLevel level); //Lower than AVX2 runs everything machine by machine, starts at detectSimdLevel()
+    SimdLevel getSimdLevel() const;
+
+    //Runs num cycles on every machine. keys holds one mask per machine, with bit k set if key k is down.
+    void cycle(uint32_t num, const uint16_t *keys);
+
+    void saveState(uint32_t index, MachineState &state) const;
+    void loadState(uint32_t index, const MachineState &state);
+    uint64_t getCycleCount(uint32_t index) const;
+    uint64_t getIdleCycleCount(uint32_t index) const;
+    bool isWaitingForKey(uint32_t index) const;
+    uint8_t readMemory(uint32_t index, uint16_t address) const;
+    const uint64_t* getScreenRows(uint32_t index) const;
+};
+
+}
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <type_traits>
 
 #include "FishCommon.hpp"
 #include "Interpreter.hpp"
+#include "Recompiler.hpp"
 
 namespace fish {
 
@@ -12,6 +15,7 @@ struct RomInfo {
     std::string name = "";
     std::string ext  = "";
     size_t      size = 0;
+    uint64_t    hash = 0; //FNV-1a of the ROM's bytes, identifies it no matter where it was loaded from
 };
 
 struct Registers {
@@ -42,42 +46,134 @@ struct Registers {
     uint8_t  SP; //SP, stack pointer
     uint8_t  DT; //DT, delay timer
     uint8_t  ST; //ST, sound timer
+
+    uint64_t RNG; //Not a CHIP-8 register, the state of the generator RND draws from
+};
+
+//Everything that makes up a running machine, so saving and restoring one is just copying
+//this around. It is plain data and a copy is a single memcpy. Settings like the clock rate,
+//core and quirk profile aren't part of it.
+struct MachineState {
+    Registers regs;
+    uint16_t  last_pc;
+    uint16_t  stack[CHIP8_STACK_MAX];
+    uint8_t   mem[CHIP8_MEM_SIZE];
+    uint64_t  screen[CHIP8_SCREEN_HEIGHT];
+    uint64_t  cycles;
+    uint64_t  idle_cycles;
+    uint32_t  timer_accum;
+    bool      waiting_for_key;
 };
 
+static_assert(std::is_trivially_copyable<MachineState>::value, "MachineState has to stay plain data");
+
 
 class Chip8 {
 private:
 
     void init();
+    //Each core returns the number of cycles it ran, less than num if it started waiting for a key
+    uint32_t runInterpreter(uint32_t num, const bool *keys);
+    template<typename Q> uint32_t runThreaded(uint32_t num, const bool *keys);
+    uint32_t runJit(uint32_t num, const bool *keys);
+    void advanceTimers(uint64_t cycles);
+    uint32_t skipIdleLoop(uint32_t remaining, const bool *keys);
+    void invalidateCode(uint16_t address, uint16_t length);
+    void tickTimers();
+    void updateRealtimeTimers(bool freeze_timers);
 
     Registers m_regs;                       //All of the registers  
     uint16_t m_last_pc;                     //PC on the last instruction       
     uint16_t m_instr;                       //The current instruction
     uint16_t m_stack[CHIP8_STACK_MAX];      //The stack holds return addresses from subroutines, it can hold up to 16
     uint8_t m_mem[CHIP8_MEM_SIZE];          //The 4kb(4096) memory, 0x0000 - 0x01ff is reserved for interpreter and font data
-    uint8_t m_screen[CHIP8_SCREEN_PIXELS];  //The screen buffer, I'm using a byte for each pixel but the screen is monochrome and only has 1bpp
-
-    long long m_last_time;                  //Used for checking the time between checking the timers
+    uint64_t m_screen[CHIP8_SCREEN_HEIGHT]; //The screen buffer, one bit per pixel and one 64-bit word per row, the leftmost pixel is the most significant bit
+    uint32_t m_dirty_rows;                  //One bit per screen row drawn to or cleared since the last consumeDirtyRows, row 0 in the lowest bit
+    uint32_t m_written_pages;               //One bit per memory page stored to since the last consumeWrittenPages, page 0 in the lowest bit
+
+    uint64_t m_cycles;                      //Number of instructions executed since the ROM was loaded
+    uint64_t m_idle_cycles;                 //Number of those instructions that were skipped over in idle loops or spent waiting for a key
+    bool m_skip_idle;                       //Fast-forward through loops that only wait for the delay timer or a key
+    bool m_waiting_for_key;                 //Set by LD Vx, K with no key down, nothing runs until a key is pressed
+    uint64_t m_seed;                        //RND is seeded with this whenever a ROM is loaded
+    bool m_deterministic;                   //Nothing is read from the wall clock, so runs only depend on the ROM, seed and keys
+    uint32_t m_clock_rate;                  //Instructions per second, determines how many cycles make up a 60 Hz timer tick
+    uint32_t m_timer_accum;                 //Accumulates CHIP8_TIMER_FREQ per instruction, the timers tick each time it reaches m_clock_rate
+    uint32_t m_timer_step;                  //CHIP8_TIMER_FREQ in cycle timer mode, 0 in realtime mode so instructions don't tick the timers
+    TimerMode m_timer_mode;
+    CoreType m_core;
+    QuirkProfile m_quirks;
+    uint32_t (Chip8::*m_run_threaded)(uint32_t, const bool*); //runThreaded for the current quirk profile
+    bool m_clip_sprites;                    //The current quirk profile's clip quirk, for the rows the interpreter marks dirty on DRW
+
+    long long m_last_time;                  //Used for checking the time between checking the timers, only used in realtime mode
+    long long m_realtime_accum;             //Leftover time (in microseconds * 60) that didn't make up a full timer tick
 
     size_t m_rom_size;
     std::string m_rom_path;
     RomInfo m_current_rom;
 
     Interpreter m_interpreter;
+    Recompiler m_jit;
+    std::unique_ptr<RewindBuffer> m_rewind; //Only created once rewinding is turned on
 
 public:
 
     Chip8();
     ~Chip8();
 
+    //A machine owns its compiled code and rewind history, so it can't be copied. State moves
+    //between machines with saveState and loadState, or is forked with a Searcher.
+    Chip8(const Chip8 &other) = delete;
+    Chip8& operator=(const Chip8 &other) = delete;
+
     StatusCode loadRom(const std::string &path);
+    StatusCode loadRom(const uint8_t *data, size_t size, const std::string &name = ""); //For ROMs that aren't in a file
     RomInfo getRomInfo() const;
 
     void cycle(uint32_t num, const bool keys[CHIP8_NUM_KEYS], bool freeze_timers = false);
+    void setClockRate(uint32_t hz);
+    uint32_t getClockRate() const;
+    void setTimerMode(TimerMode mode); //Realtime timers are ignored in deterministic mode
+    TimerMode getTimerMode() const;
+    void setRandomSeed(uint64_t seed); //Reseeds RND now and whenever a ROM is loaded
+    uint64_t getRandomSeed() const;
+    void setDeterministic(bool enabled);
+    bool isDeterministic() const;
+    uint64_t getCycleCount() const;
+    uint64_t getIdleCycleCount() const;
+    uint32_t getCyclesToTimerTick() const; //Instructions until the timers next tick, 0 with realtime timers
+    void setIdleSkipping(bool enabled);
+    bool isWaitingForKey() const;
+    void setCore(CoreType core);
+    CoreType getCore() const;
+    void setQuirkProfile(QuirkProfile profile);
+    QuirkProfile getQuirkProfile() const;
     uint8_t getScreenPixel(uint8_t x, uint8_t y) const;
-    bool shouldPlaySound();
+    uint64_t getScreenRow(uint8_t y) const;
+    const uint64_t* getScreenRows() const;
+    void expandScreen(uint8_t pixels[CHIP8_SCREEN_PIXELS]) const; //Unpacks the screen into one byte per pixel, 0 or 1
+    uint64_t getScreenHash() const; //FNV-1a hash of the screen rows, the same on every platform
+    uint32_t getDirtyRows() const;
+    uint32_t consumeDirtyRows(); //Returns the rows changed since the last call, then clears them
+    uint32_t consumeWrittenPages(); //Returns the memory pages stored to since the last call, then clears them
+    bool shouldPlaySound() const;
     bool detectLoop();
 
+    //Only the memory pages set in pages are copied, the rest of the state always is. Loading fewer
+    //pages is for callers that know the others already match.
+    void saveState(MachineState &state, uint32_t pages = CHIP8_ALL_PAGES) const;
+    void loadState(const MachineState &state, uint32_t pages = CHIP8_ALL_PAGES);
+    StatusCode saveStateFile(const std::string &path) const;
+    StatusCode loadStateFile(const std::string &path);
+
+    //Rewinding keeps the last frames of state, recorded once per frame by whoever runs the machine
+    void setRewindLength(uint32_t frames, uint32_t keyframe_interval = CHIP8_TIMER_FREQ); //0 frames turns it off
+    void recordRewindFrame();
+    bool rewindFrame(); //Goes back to the last recorded frame and forgets it, false if there is nothing left
+    uint32_t getRewindFrameCount() const;
+    size_t getRewindByteCount() const;
+
     friend class Debugger;
 };
 
@@ -4,6 +4,22 @@
 
 namespace fish {
 
+//Everything the debugger shows, copied out of the emulator at one point in time so
+//nothing in it can change while it is being displayed
+struct DebugSnapshot {
+    Registers regs;
+    uint16_t  last_pc;
+    uint16_t  stack[CHIP8_STACK_MAX];
+    uint8_t   mem[CHIP8_MEM_SIZE];
+    uint64_t  screen[CHIP8_SCREEN_HEIGHT]; //One 64-bit word per row
+    uint64_t  cycles;
+    bool      waiting_for_key;
+    bool      play_sound;
+};
+
+//Reads and edits the state of an attached emulator. When the emulator runs on another
+//thread, capture and the setters have to be called from that thread, everything else
+//only looks at snapshots and is safe to call from anywhere.
 class Debugger {
 private:
 
@@ -20,18 +36,18 @@ public:
 
     bool hasInstance() const;
 
-    uint8_t*  getMemory();
-    uint16_t* getStack();
-    uint8_t*  getScreen();
+    void capture(DebugSnapshot &snapshot);
 
-    uint8_t*  getVRegister(size_t index);
-    uint8_t*  getStackPointer();
-    uint16_t* getIRegister();
-    uint16_t* getProgramCounter();
-    uint8_t*  getDelayTimer();
-    uint8_t*  getSoundTimer();
+    void setVRegister(size_t index, uint8_t value);
+    void setStackPointer(uint8_t value);
+    void setStackEntry(size_t index, uint16_t value);
+    void setIRegister(uint16_t value);
+    void setProgramCounter(uint16_t value);
+    void setDelayTimer(uint8_t value);
+    void setSoundTimer(uint8_t value);
+    void writeMemory(uint16_t address, uint8_t value);
 
-    uint16_t getInstructionAt(uint16_t address);
+    static uint16_t getInstructionAt(const DebugSnapshot &snapshot, uint16_t address);
 
     std::string disassemble(uint16_t instruction);
 };
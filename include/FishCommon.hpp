@@ -10,9 +10,31 @@ class Chip8;
 class Debugger;
 struct RomInfo;
 struct Registers;
+struct MachineState;
+class RewindBuffer;
 
 enum StatusCode {
-    OK, FILE_NOT_FOUND, FILE_NOT_GOOD, INVALID_FILE_SIZE
+    OK, FILE_NOT_FOUND, FILE_NOT_GOOD, INVALID_FILE_SIZE, INVALID_STATE
+};
+
+//How the delay and sound timers are driven. Cycle timers tick every (clock rate / 60)
+//emulated instructions, so runs are reproducible, realtime timers follow the wall clock.
+enum TimerMode {
+    CYCLE_TIMERS, REALTIME_TIMERS
+};
+
+//Which execution core Chip8::cycle runs instructions with. The interpreter calls through
+//the instruction function table, the threaded core keeps the machine state in locals and
+//dispatches directly from one instruction to the next, and the JIT core runs basic blocks
+//recompiled to x86-64 code, interpreting whatever it can't compile.
+enum CoreType {
+    INTERPRETER_CORE, THREADED_CORE, JIT_CORE
+};
+
+//Which interpreter's behavior to follow where they disagree, the details of each are in
+//Quirks.hpp. Modern is what Fish-8 has always done.
+enum QuirkProfile {
+    MODERN_QUIRKS, COSMAC_VIP_QUIRKS, CHIP48_QUIRKS, SCHIP_QUIRKS
 };
 
 static constexpr uint32_t CHIP8_MEM_SIZE      = 4096; //0x1000 or 4kb
@@ -23,6 +45,63 @@ static constexpr uint32_t CHIP8_NUM_KEYS      = 16;
 static constexpr uint32_t CHIP8_SCREEN_WIDTH  = 64;
 static constexpr uint32_t CHIP8_SCREEN_HEIGHT = 32;
 static constexpr uint32_t CHIP8_SCREEN_PIXELS = CHIP8_SCREEN_WIDTH * CHIP8_SCREEN_HEIGHT;
+static constexpr uint32_t CHIP8_PAGE_SIZE     = 256; //Memory is tracked in pages this big when states are moved a piece at a time
+static constexpr uint32_t CHIP8_MEM_PAGES     = CHIP8_MEM_SIZE / CHIP8_PAGE_SIZE;
+static constexpr uint32_t CHIP8_ALL_PAGES     = (1u << CHIP8_MEM_PAGES) - 1; //One bit per page, page 0 in the lowest bit
+static constexpr uint32_t CHIP8_TIMER_FREQ    = 60;  //DT and ST count down at 60 Hz
+static constexpr uint32_t CHIP8_DEFAULT_CLOCK = 500; //Instructions per second
+static constexpr uint64_t CHIP8_DEFAULT_SEED  = 0x853c49e6748fea9b; //RND seed used unless another one is set
+
+//RND draws from a PCG32 generator (PCG-XSH-RR with a fixed increment). Its whole state is one
+//64-bit word, so it is kept with the registers and saved and restored along with them.
+inline uint32_t nextRandom(uint64_t &state) {
+    uint64_t old = state;
+    state = old * 6364136223846793005ull + 1442695040888963407ull;
+
+    uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+    uint32_t rot = static_cast<uint32_t>(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+}
+
+//The generator state a seed starts from
+inline uint64_t seedRandom(uint64_t seed) {
+    uint64_t state = 0;
+    nextRandom(state);
+    state += seed;
+    nextRandom(state);
+    return state;
+}
+
+//I is 16 bits wide and profiles that move it after loads and stores can walk it past the
+//end of memory, so every access through it wraps around to the start
+inline uint16_t wrapAddress(uint32_t address) {
+    return address & (CHIP8_MEM_SIZE - 1);
+}
+
+//The screen is stored as one 64-bit word per row, with the leftmost pixel in the most significant bit.
+//Places an 8 pixel sprite row at x, wrapping around to the left edge, which is a single rotate.
+inline uint64_t placeSpriteRow(uint8_t sprite_line, uint32_t x) {
+    uint64_t row = static_cast<uint64_t>(sprite_line) << (CHIP8_SCREEN_WIDTH - 8);
+    x &= CHIP8_SCREEN_WIDTH - 1;
+    return (row >> x) | (row << ((CHIP8_SCREEN_WIDTH - x) & (CHIP8_SCREEN_WIDTH - 1)));
+}
+
+//Same as placeSpriteRow, but whatever goes past the right edge is cut off
+inline uint64_t clipSpriteRow(uint8_t sprite_line, uint32_t x) {
+    return (static_cast<uint64_t>(sprite_line) << (CHIP8_SCREEN_WIDTH - 8)) >> (x & (CHIP8_SCREEN_WIDTH - 1));
+}
+
+//The rows a sprite n rows tall drawn at y covers, one bit per row with row 0 in the lowest
+//bit. Wrapping sprites continue at the top of the screen, clipped ones are cut off.
+inline uint32_t spriteRows(uint32_t y, uint32_t n, bool clip) {
+    uint32_t rows = (1u << n) - 1;
+    y &= CHIP8_SCREEN_HEIGHT - 1;
+    return clip ? rows << y : (rows << y) | (rows >> ((CHIP8_SCREEN_HEIGHT - y) & (CHIP8_SCREEN_HEIGHT - 1)));
+}
+
+inline bool screenPixel(const uint64_t *rows, uint32_t x, uint32_t y) {
+    return (rows[y] >> (CHIP8_SCREEN_WIDTH - 1 - x)) & 1;
+}
 
 }
 
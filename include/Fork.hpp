@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Chip8.hpp"
+
+namespace fish {
+
+//Reference counted CHIP8_PAGE_SIZE byte pages for the states of one Searcher. Pages are handed
+//out by index from chunks that never move, and are only ever used from one thread.
+class PageArena {
+private:
+
+    static constexpr uint32_t CHUNK_PAGES = 256;
+
+    std::vector<std::unique_ptr<uint8_t[]>> m_chunks;
+    std::vector<uint32_t> m_refs;
+    std::vector<uint64_t> m_serials; //Changes whenever a page gets new contents, so a copy of it can be recognized
+    std::vector<uint32_t> m_free;
+    uint64_t m_next_serial;
+
+public:
+
+    PageArena();
+    ~PageArena();
+
+    uint32_t allocate(); //A new page with one reference, its contents are undefined
+    void retain(uint32_t page) { m_refs[page]++; }
+    void release(uint32_t page);
+    void touch(uint32_t page) { m_serials[page] = m_next_serial++; } //Call after changing a page in place
+
+    uint8_t* data(uint32_t page) { return &m_chunks[page / CHUNK_PAGES][(page % CHUNK_PAGES) * CHIP8_PAGE_SIZE]; }
+    uint32_t refs(uint32_t page) const { return m_refs[page]; }
+    uint64_t serial(uint32_t page) const { return m_serials[page]; }
+
+    size_t getPageCount() const; //Pages in use
+    size_t getByteCount() const; //Bytes held by the arena, used or not
+};
+
+//A machine state that shares its memory and screen with the states it was forked from. The
+//registers, stack and counters are copied, memory and the screen are pages in the Searcher's
+//arena that are only copied once one of the states writes to them. Copying a ForkState is a
+//fork, states must not outlive the Searcher that made them.
+class ForkState {
+private:
+
+    friend class Searcher;
+
+    void releasePages();
+
+    PageArena *m_arena = nullptr;
+    uint32_t m_pages[CHIP8_MEM_PAGES];
+    uint32_t m_screen; //CHIP8_SCREEN_HEIGHT rows fill exactly one page
+
+    Registers m_regs;
+    uint16_t m_last_pc;
+    uint16_t m_stack[CHIP8_STACK_MAX];
+    uint64_t m_cycles;
+    uint64_t m_idle_cycles;
+    uint32_t m_timer_accum;
+    bool m_waiting_for_key;
+
+public:
+
+    ForkState() { }
+    ForkState(const ForkState &other);
+    ForkState(ForkState &&other) noexcept;
+    ForkState& operator=(const ForkState &other);
+    ForkState& operator=(ForkState &&other) noexcept;
+    ~ForkState();
+
+    ForkState fork() const { return *this; }
+    bool isValid() const { return m_arena != nullptr; }
+
+    const Registers& getRegisters() const { return m_regs; }
+    uint64_t getCycleCount() const { return m_cycles; }
+    bool isWaitingForKey() const { return m_waiting_for_key; }
+    uint8_t readMemory(uint16_t address) const;
+    const uint64_t* getScreenRows() const;
+    uint64_t getScreenHash() const; //Same as Chip8::getScreenHash
+};
+
+//Runs ForkStates for tree search. Every state is run on the searcher's own Chip8, which only
+//has to be sent the pages that differ from the last state it ran, and only the pages a run
+//writes to are copied out of it again. Not thread safe, give each search thread its own.
+class Searcher {
+private:
+
+    PageArena m_arena;
+    Chip8 m_emu;
+    MachineState m_state;                 //Scratch space for moving states in and out of m_emu
+    uint64_t m_loaded[CHIP8_MEM_PAGES];   //Serial number of the page each part of m_emu's memory holds, 0 if none
+
+    uint32_t copyPage(const uint8_t *data);
+
+public:
+
+    Searcher();
+    ~Searcher();
+
+    //A state to start searching from, with emu's memory, screen and registers. The searcher also
+    //takes on emu's clock rate, quirk profile and core, and always runs deterministically.
+    ForkState capture(const Chip8 &emu);
+
+    void run(ForkState &state, uint32_t num, const bool keys[CHIP8_NUM_KEYS]);
+    void restore(const ForkState &state, Chip8 &emu); //Puts state into emu, e.g. to play on from the chosen one
+
+    const PageArena& getArena() const;
+};
+
+}
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
 #include <unordered_map>
 
+#include "Quirks.hpp"
+
 //The instruction is stripped of the operand
 //which are replaced by zero.
 //Instructions from Cowgod's Chip-8 Reference
@@ -113,40 +117,43 @@ struct Registers;
 //numbers or letters following the underscore. These numbers, or letters
 //correspond to the instructions starting digit, or more for the cases of
 //AND and LD.
-void NOP    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void CLS    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void RET    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void JP_1   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void CALL   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SE_3   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SNE_4  (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SE_5   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_6   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void ADD_7  (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_8   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void OR     (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void AND    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void XOR    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void ADD_8  (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SUB    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SHR    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SUBN   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SHL    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SNE_9  (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_A   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void JP_B   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void RND    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void DRW    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SKP    (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void SKNP   (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F07 (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F0A (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F15 (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F18 (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void ADD_F  (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F29 (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F33 (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F55 (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
-void LD_F65 (uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys);
+//
+//Instructions that behave differently between interpreters are templates over a quirk
+//policy from Quirks.hpp, instantiated for each profile in Instruction.cpp.
+void NOP    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void CLS    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void RET    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void JP_1   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void CALL   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SE_3   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SNE_4  (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SE_5   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_6   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void ADD_7  (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_8   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void OR     (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void AND    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void XOR    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void ADD_8  (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SUB    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void SHR    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SUBN   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void SHL    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SNE_9  (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_A   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void JP_B   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void RND    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void DRW    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SKP    (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void SKNP   (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_F07 (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_F0A (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_F15 (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_F18 (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void ADD_F  (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_F29 (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+void LD_F33 (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void LD_F55 (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
+template<typename Q> void LD_F65 (uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys);
 
 }
\ No newline at end of file
@@ -4,11 +4,38 @@
 #include <unordered_map>
 #include <array>
 
+#include "FishCommon.hpp"
+
 namespace fish {
 
 struct Registers;
 
-using InstructionFunc = void(*)(uint16_t, Registers&, uint8_t* /* mem */, uint8_t* /* screen */, uint16_t* /* stack */, const bool* /* keys */);
+using InstructionFunc = void(*)(uint16_t, Registers&, uint8_t* /* mem */, uint64_t* /* screen */, uint16_t* /* stack */, const bool* /* keys */);
+
+//Indices into the instruction function table, in the same order as the functions in Instruction.hpp
+enum Opcode : uint8_t {
+    OP_NOP,    OP_CLS,    OP_RET,    OP_JP_1,
+    OP_CALL,   OP_SE_3,   OP_SNE_4,  OP_SE_5,
+    OP_LD_6,   OP_ADD_7,  OP_LD_8,   OP_OR,
+    OP_AND,    OP_XOR,    OP_ADD_8,  OP_SUB,
+    OP_SHR,    OP_SUBN,   OP_SHL,    OP_SNE_9,
+    OP_LD_A,   OP_JP_B,   OP_RND,    OP_DRW,
+    OP_SKP,    OP_SKNP,   OP_LD_F07, OP_LD_F0A,
+    OP_LD_F15, OP_LD_F18, OP_ADD_F,  OP_LD_F29,
+    OP_LD_F33, OP_LD_F55, OP_LD_F65,
+    OP_COUNT,
+    OP_UNDECODED = 0xff //Marks a decode cache entry that has to be decoded on its next fetch
+};
+
+//An instruction with all of its operand fields extracted ahead of time
+struct DecodedInstruction {
+    uint8_t  opcode; //Index into the instruction function table
+    uint8_t  x;      //-x--
+    uint8_t  y;      //--y-
+    uint8_t  n;      //---n
+    uint8_t  nn;     //--nn
+    uint16_t nnn;    //-nnn, also the operands that are passed to the instruction functions
+};
 
 class Interpreter {
 private:
@@ -16,7 +43,12 @@ public:
     uint8_t m_opcode;                                //A number corrosponding to the instruction function in the instructions map
     uint16_t m_operands;                             //16-bit in order to hold the possible 12-bit operand
 
-    std::array<InstructionFunc, 35> m_instructions;  //An array containing the instruction's function pointers
+    std::array<InstructionFunc, OP_COUNT> m_instructions;  //An array containing the instruction's function pointers
+
+    //Decoded instructions for every address in memory, filled in lazily the first time an address is executed
+    std::array<DecodedInstruction, CHIP8_MEM_SIZE> m_cache;
+
+    void fill(DecodedInstruction &entry, const uint8_t *mem, uint16_t address);
 
 //public:
 
@@ -24,7 +56,22 @@ public:
     ~Interpreter();
 
     void decode(uint16_t instr);
-    void execute(Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys); //Executes last instruction decoded
+    void setQuirks(QuirkProfile profile); //Switches the instruction table to the functions for profile
+    void execute(Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys); //Executes last instruction decoded
+
+    //Returns the decoded instruction at address, decoding it if it isn't cached yet
+    inline const DecodedInstruction& fetch(const uint8_t *mem, uint16_t address) {
+        DecodedInstruction &entry = m_cache[address];
+        if(entry.opcode == OP_UNDECODED) { fill(entry, mem, address); }
+        return entry;
+    }
+
+    inline void execute(const DecodedInstruction &instr, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
+        m_instructions[instr.opcode](instr.nnn, regs, mem, screen, stack, keys);
+    }
+
+    void invalidate(uint16_t address, uint16_t length); //Must be called whenever memory is written to
+    void invalidateAll();
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Chip8.hpp"
+
+namespace fish {
+
+//Movie files start with "F8MV" and a version number, the keyframes inside are save states
+static constexpr uint32_t MOVIE_MAGIC   = 0x564d3846; //"F8MV" in file order
+static constexpr uint32_t MOVIE_VERSION = 1;
+
+//The keys held down from cycle on, one bit per key in the same order as the key array
+struct MovieInput {
+    uint64_t cycle;
+    uint16_t keys;
+};
+
+//A whole machine state part way through, so playback can start from here instead of the beginning
+struct MovieKeyframe {
+    uint32_t input;      //How many inputs came before it
+    uint16_t keys;       //The keys held down at the time
+    MachineState state;  //state.cycles is the cycle it was taken at
+};
+
+//A recording of everything that went into a run, so it plays back the same every time. Inputs
+//are stamped with the emulated cycle they took effect on rather than a frame or a time, so
+//playback doesn't depend on the frame rate or run speed it was recorded at. The first
+//keyframe is where the recording starts, which doesn't have to be when the ROM was loaded.
+struct Movie {
+    uint64_t rom_hash = 0;
+    QuirkProfile quirks = MODERN_QUIRKS;
+    uint32_t clock_rate = CHIP8_DEFAULT_CLOCK; //Timers always run off cycles in a movie
+    uint64_t rng_seed = CHIP8_DEFAULT_SEED;    //What the machine was seeded with, keyframes carry the generator itself
+    uint64_t end_cycle = 0;
+    std::vector<MovieInput> inputs;
+    std::vector<MovieKeyframe> keyframes;
+};
+
+uint16_t packKeys(const bool keys[CHIP8_NUM_KEYS]);
+void unpackKeys(uint16_t mask, bool keys[CHIP8_NUM_KEYS]);
+
+std::vector<uint8_t> serializeMovie(const Movie &movie);
+StatusCode deserializeMovie(const uint8_t *data, size_t size, Movie &movie); //INVALID_STATE if it isn't a movie this version can read
+StatusCode saveMovieFile(const std::string &path, const Movie &movie);
+StatusCode loadMovieFile(const std::string &path, Movie &movie);
+
+//Builds a movie from a running machine. update is called with the keys before every call to
+//Chip8::cycle, it records them if they changed and takes a keyframe every keyframe_interval cycles.
+class MovieRecorder {
+private:
+
+    Movie m_movie;
+    bool m_recording;
+    uint16_t m_keys;
+    uint64_t m_keyframe_interval;
+    uint64_t m_next_keyframe;
+
+    void addKeyframe(const Chip8 &emu);
+
+public:
+
+    MovieRecorder();
+
+    void start(const Chip8 &emu, uint64_t keyframe_interval);
+    void update(const Chip8 &emu, const bool keys[CHIP8_NUM_KEYS]);
+    void truncate(const Chip8 &emu); //Drops everything after where emu is now, for when it was rewound
+    Movie stop(const Chip8 &emu);
+    bool isRecording() const;
+    const Movie& getMovie() const;
+};
+
+//Plays a movie back into a machine with the same ROM loaded, as fast as run is called
+class MoviePlayer {
+private:
+
+    Movie m_movie;
+    bool m_playing;
+    uint16_t m_keys;
+    size_t m_next_input;
+
+public:
+
+    MoviePlayer();
+
+    StatusCode start(Chip8 &emu, Movie movie); //INVALID_STATE if the movie is for another ROM
+    void seek(Chip8 &emu, uint64_t cycle); //Starts from the closest keyframe before cycle and runs up to it
+    uint64_t run(Chip8 &emu, uint64_t cycles); //Returns the cycles actually run, less at the end of the movie
+    void stop();
+    bool isPlaying() const;
+    bool isFinished(const Chip8 &emu) const;
+    const Movie& getMovie() const;
+};
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FishCommon.hpp"
+
+namespace fish {
+
+//How long every machine runs and how the work is cut up
+struct RunBudget {
+    uint64_t cycles  = CHIP8_DEFAULT_CLOCK;                      //Instructions every machine runs in total
+    uint32_t quantum = CHIP8_DEFAULT_CLOCK / CHIP8_TIMER_FREQ;   //Instructions per quantum, the screen is hashed after each one
+    double   slice   = 0;                                        //Seconds a worker keeps running quanta of one machine before it is handed back, 0 for a single quantum
+};
+
+//What a machine ended up with. Each one is only ever written by the worker that holds the machine.
+struct RunResult {
+    uint64_t screen_hash = 0;  //Chip8::getScreenHash at the end
+    uint64_t frame_hash  = 0xcbf29ce484222325; //FNV-1a over the screen hash after every quantum, catches differences along the way
+    uint64_t cycles      = 0;  //Instructions run by this run
+    uint64_t idle_cycles = 0;
+    uint64_t quanta      = 0;
+    double   seconds     = 0;  //Time spent running the machine, not counting time spent waiting to be scheduled
+    uint32_t worker      = 0;  //The worker that ran the last quantum
+};
+
+//Fixed size Chase-Lev deque of machine indices. The owning worker pushes and pops at the bottom,
+//the others steal from the top, all without locks.
+class WorkDeque {
+private:
+
+    std::unique_ptr<std::atomic<uint32_t>[]> m_items;
+    size_t m_capacity;
+    std::atomic<int64_t> m_top;
+    std::atomic<int64_t> m_bottom;
+
+public:
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    WorkDeque();
+
+    void reset(size_t capacity); //Empties the deque and makes room for capacity items, only while nothing else uses it
+    void push(uint32_t item); //Owner only, there must be room
+    uint32_t pop();           //Owner only, EMPTY if there is nothing left
+    uint32_t steal();         //Any thread, EMPTY if there was nothing or another thread got to it first
+};
+
+//Runs collections of independent machines on a pool of worker threads. Machines are dealt out
+//round robin and each worker runs its own a quantum at a time, stealing from the others once it
+//runs out and sitting the rest of the run out once there is nothing left to steal. Results go
+//straight into the caller's array, one slot per machine, so nothing but the deques is shared
+//while running. The deques are made once and only grow when a run has more machines.
+class ParallelRunner {
+private:
+
+    void workerLoop(uint32_t index);
+    void runMachines(uint32_t index);
+    bool runSlice(uint32_t index, uint32_t machine); //True once the machine has used up its budget
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<WorkDeque>> m_deques;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_steals; //Per worker
+
+    //Starting and finishing a run is the only time the workers and the caller wait on each other
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    uint64_t m_generation;
+    uint32_t m_busy;
+    bool m_quit;
+
+    //The current run
+    Chip8 *const *m_machines;
+    RunResult *m_results;
+    RunBudget m_budget;
+    std::atomic<size_t> m_unfinished;
+
+public:
+
+    ParallelRunner(uint32_t threads = 0); //0 uses every hardware thread
+    ~ParallelRunner();
+
+    uint32_t getThreadCount() const;
+
+    //Runs every machine with all keys up until it has used up budget.cycles. Blocks until they are
+    //all done. results must hold count entries.
+    void run(Chip8 *const *machines, size_t count, const RunBudget &budget, RunResult *results);
+    uint64_t getStealCount() const; //Machines taken from another worker's deque during the last run
+};
+
+}
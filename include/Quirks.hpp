@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include "FishCommon.hpp"
+
+namespace fish {
+
+//How far LD [I], Vx and LD Vx, [I] move I after copying
+enum IndexIncrement {
+    I_UNCHANGED, I_PLUS_X, I_PLUS_X_PLUS_1
+};
+
+//A quirk profile as a compile-time policy. The execution cores are templates over these,
+//so every profile gets its own instantiation and nothing is checked at runtime.
+template<bool ShiftVy, IndexIncrement Increment, bool ResetVF, bool Clip, bool JumpVx>
+struct Quirks {
+    static constexpr bool           shift_vy  = ShiftVy;   //SHR and SHL shift Vy into Vx, instead of shifting Vx in place
+    static constexpr IndexIncrement increment = Increment; //How I changes after Fx55 and Fx65
+    static constexpr bool           reset_vf  = ResetVF;   //OR, AND, and XOR set VF to 0
+    static constexpr bool           clip      = Clip;      //DRW cuts sprites off at the screen edges instead of wrapping them
+    static constexpr bool           jump_vx   = JumpVx;    //Bxnn jumps to xnn + Vx instead of nnn + V0
+
+    //Number of bytes I moves by after loading or storing V0 through Vx
+    static constexpr uint16_t indexStep(uint8_t x) {
+        return Increment == I_PLUS_X_PLUS_1 ? x + 1 : Increment == I_PLUS_X ? x : 0;
+    }
+};
+
+using ModernQuirks    = Quirks<false, I_UNCHANGED,     false, false, false>; //What Fish-8 has always done
+using CosmacVipQuirks = Quirks<true,  I_PLUS_X_PLUS_1, true,  true,  false>; //The original interpreter
+using Chip48Quirks    = Quirks<false, I_PLUS_X,        false, true,  true>;  //CHIP-48 on the HP-48
+using SchipQuirks     = Quirks<false, I_UNCHANGED,     false, true,  true>;  //SUPER-CHIP 1.1
+
+//Calls func with a default constructed policy for profile, so a generic lambda can pick the
+//matching instantiation of a template
+template<typename Func>
+inline auto withQuirks(QuirkProfile profile, Func &&func) {
+    switch(profile) {
+        case COSMAC_VIP_QUIRKS : return func(CosmacVipQuirks());
+        case CHIP48_QUIRKS : return func(Chip48Quirks());
+        case SCHIP_QUIRKS : return func(SchipQuirks());
+        default : return func(ModernQuirks());
+    }
+}
+
+}
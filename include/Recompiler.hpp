@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+
+#include "FishCommon.hpp"
+
+namespace fish {
+
+class Interpreter;
+struct DecodedInstruction;
+
+//Native code for a block takes the registers, the key states, and memory. It leaves PC
+//pointing at the next instruction to execute.
+using BlockFunc = void(*)(Registers* /* regs */, const bool* /* keys */, uint8_t* /* mem */);
+
+enum BlockState : uint8_t {
+    UNCOMPILED, COMPILED, UNCOMPILABLE
+};
+
+struct Block {
+    BlockFunc  code;
+    uint16_t   bytes;  //Number of bytes of Chip-8 memory the block was compiled from
+    uint8_t    length; //Number of instructions in the block
+    BlockState state;
+};
+
+//Translates straight-line runs of Chip-8 instructions into x86-64 code. A block ends at
+//a jump or skip, which is compiled, or right before anything that touches the stack,
+//timers, screen, keys waiting, random numbers or stores to memory, which is left to the
+//interpreter. On other architectures nothing gets compiled and everything is interpreted.
+class Recompiler {
+private:
+
+    static constexpr uint32_t MAX_BLOCK_LENGTH = 64;
+    static constexpr size_t   BUFFER_SIZE      = 1024 * 1024;
+
+    std::array<Block, CHIP8_MEM_SIZE> m_blocks;
+    uint8_t *m_buffer;  //Code memory, allocated the first time something is compiled and only writable while a block is copied in
+    size_t m_used;
+    std::vector<uint8_t> m_code; //Code for the block being compiled
+    QuirkProfile m_quirks;       //Blocks are compiled for one profile at a time
+
+    const Block* compile(Interpreter &interpreter, const uint8_t *mem, uint16_t address);
+    template<typename Q> bool emit(const DecodedInstruction &instr, uint16_t address);
+
+public:
+
+    Recompiler();
+    ~Recompiler();
+
+    //The code buffer belongs to the one machine that owns the recompiler, which is never copied
+    Recompiler(const Recompiler &other) = delete;
+    Recompiler& operator=(const Recompiler &other) = delete;
+
+    static bool isSupported();
+
+    //Returns the block starting at address, compiling it if needed, or nullptr if the
+    //instruction at address has to be interpreted
+    inline const Block* lookup(Interpreter &interpreter, const uint8_t *mem, uint16_t address) {
+        const Block &block = m_blocks[address];
+        if(block.state == COMPILED) { return &block; }
+        if(block.state == UNCOMPILABLE) { return nullptr; }
+        return compile(interpreter, mem, address);
+    }
+
+    void invalidate(uint16_t address, uint16_t length); //Must be called whenever memory is written to
+    void invalidateAll();
+    void setQuirks(QuirkProfile profile); //Throws away every block if the profile changes
+};
+
+}
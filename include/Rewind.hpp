@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Chip8.hpp"
+
+namespace fish {
+
+//A run of frames that starts with a keyframe, each frame is run-length encoded
+struct RewindGroup {
+    std::vector<uint8_t>  data;    //The encoded frames one after another
+    std::vector<uint32_t> offsets; //Where each frame starts in data
+};
+
+//Holds the last frames of machine state for rewinding. Every keyframe_interval frames the
+//whole state is stored, the frames in between only store how they differ from the frame
+//before them, XORed together so unchanged bytes are zero, with the zeros run-length encoded.
+//Going back one frame is applying the newest difference again, only stepping back over a
+//keyframe has to decode the group before it. The oldest group is dropped once there are
+//more than capacity frames.
+class RewindBuffer {
+private:
+
+    std::deque<RewindGroup> m_groups;
+    uint32_t m_capacity;          //In frames, 0 means nothing is recorded
+    uint32_t m_keyframe_interval;
+    uint32_t m_frames;            //Frames currently held
+    size_t m_bytes;               //Encoded bytes currently held
+
+    MachineState m_newest;        //The newest frame decoded, deltas are taken against it
+    MachineState m_scratch;
+
+    static void encode(const uint8_t *state, const uint8_t *base, std::vector<uint8_t> &out);
+    static void apply(const uint8_t *encoded, uint8_t *state);
+    void decodeLast(const RewindGroup &group, MachineState &state);
+
+public:
+
+    RewindBuffer();
+
+    void setCapacity(uint32_t frames, uint32_t keyframe_interval);
+    uint32_t getCapacity() const;
+    void clear();
+
+    void push(const MachineState &state);
+    bool pop(MachineState &state); //Gives back the newest frame and forgets it, false if there are none
+
+    uint32_t getFrameCount() const;
+    size_t getByteCount() const; //Memory used by the encoded frames
+};
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Chip8.hpp"
+
+namespace fish {
+
+//Save state files start with "F8SS" and a version number. Every field is written on its own
+//in little-endian order, so files move between platforms and compilers, and older versions
+//stay loadable when fields are added.
+static constexpr uint32_t STATE_MAGIC   = 0x53533846; //"F8SS" in file order
+static constexpr uint32_t STATE_VERSION = 2; //2 added the RND generator
+
+//Appends little-endian values to a buffer, shared by every file format that holds states
+class StateWriter {
+private:
+
+    std::vector<uint8_t> &m_out;
+
+public:
+
+    StateWriter(std::vector<uint8_t> &out) : m_out(out) { }
+
+    void put(uint64_t value, uint32_t bytes) {
+        for(uint32_t i = 0; i < bytes; i++) {
+            m_out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void put8(uint8_t value)   { put(value, 1); }
+    void put16(uint16_t value) { put(value, 2); }
+    void put32(uint32_t value) { put(value, 4); }
+    void put64(uint64_t value) { put(value, 8); }
+    void putBytes(const uint8_t *data, size_t size) { m_out.insert(m_out.end(), data, data + size); }
+};
+
+//Reads little-endian values, once anything runs past the end every read returns zero and good() is false
+class StateReader {
+private:
+
+    const uint8_t *m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    bool m_good = true;
+
+public:
+
+    StateReader(const uint8_t *data, size_t size) : m_data(data), m_size(size) { }
+
+    uint64_t get(uint32_t bytes) {
+        if(!m_good || m_size - m_pos < bytes) {
+            m_good = false;
+            return 0;
+        }
+
+        uint64_t value = 0;
+        for(uint32_t i = 0; i < bytes; i++) {
+            value |= static_cast<uint64_t>(m_data[m_pos++]) << (i * 8);
+        }
+
+        return value;
+    }
+
+    uint8_t  get8()  { return static_cast<uint8_t>(get(1)); }
+    uint16_t get16() { return static_cast<uint16_t>(get(2)); }
+    uint32_t get32() { return static_cast<uint32_t>(get(4)); }
+    uint64_t get64() { return get(8); }
+
+    void getBytes(uint8_t *data, size_t size) {
+        if(!m_good || m_size - m_pos < size) {
+            m_good = false;
+            return;
+        }
+
+        memcpy(data, m_data + m_pos, size);
+        m_pos += size;
+    }
+
+    size_t remaining() const { return m_good ? m_size - m_pos : 0; }
+    bool good() const { return m_good; }
+};
+
+std::vector<uint8_t> serializeState(const MachineState &state);
+StatusCode deserializeState(const uint8_t *data, size_t size, MachineState &state); //INVALID_STATE if it isn't a save state this version can read
+
+}
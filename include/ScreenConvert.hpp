@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FishCommon.hpp"
+
+namespace fish {
+
+//Byte layouts convertScreen can produce, one pixel after another with no padding
+enum PixelFormat {
+    PIXEL_RGBA8, PIXEL_RGB8, PIXEL_GRAY8
+};
+
+//Which instructions convertScreen uses. SSE2 is always there on x86-64, AVX2 is only
+//used if the CPU has it, everything else gets the scalar version.
+enum SimdLevel {
+    SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2
+};
+
+uint32_t bytesPerPixel(PixelFormat format);
+size_t convertedScreenSize(PixelFormat format, uint32_t scale, uint32_t num_rows = CHIP8_SCREEN_HEIGHT); //In bytes
+SimdLevel detectSimdLevel(); //The best level this CPU supports
+
+//Expands num_rows screen rows (one bit per pixel, leftmost pixel in the most significant bit)
+//into out, with every pixel repeated scale times in both directions. Colors are 0xRRGGBBAA,
+//grayscale uses their luma. out must hold convertedScreenSize(format, scale, num_rows) bytes.
+void convertScreen(const uint64_t *rows, uint32_t num_rows, uint8_t *out, PixelFormat format, uint32_t scale, uint32_t foreground, uint32_t background);
+void convertScreen(const uint64_t *rows, uint32_t num_rows, uint8_t *out, PixelFormat format, uint32_t scale, uint32_t foreground, uint32_t background, SimdLevel level);
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace fish {
+
+//Hands complete values of T from one writer thread to one reader thread without locks.
+//The writer fills back() and publishes it, the reader consumes and then reads front().
+//Neither side ever waits, the reader always gets the newest published value and skips
+//any it was too slow to see, and a value is never modified while it is being read.
+template<typename T>
+class TripleBuffer {
+private:
+
+    //The low two bits of m_middle are the index of the slot between the two threads,
+    //FRESH is set when that slot was published and hasn't been consumed yet
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH      = 0x4;
+
+    T m_slots[3];
+    uint8_t m_back  = 0; //Only touched by the writer
+    uint8_t m_front = 1; //Only touched by the reader
+    std::atomic<uint8_t> m_middle{2};
+
+public:
+
+    T& back() { return m_slots[m_back]; }
+    const T& front() const { return m_slots[m_front]; }
+
+    //Makes the value in back() the newest one and gives the writer a different slot to fill.
+    //The new back() holds an old value, not a copy of what was just published.
+    void publish() {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    //Moves the newest published value to front(), returns false if there was nothing new
+    bool consume() {
+        if(!(m_middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+};
+
+}
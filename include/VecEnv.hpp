@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BatchCore.hpp"
+#include "Chip8.hpp"
+#include "ScreenConvert.hpp"
+
+namespace fish {
+
+//How the bytes at a reward address are read
+enum RewardEncoding {
+    REWARD_BYTE,   //One unsigned byte
+    REWARD_WORD,   //Two bytes, most significant first like the instructions
+    REWARD_DIGITS  //One decimal digit per byte, most significant first, the way LD B, Vx stores scores
+};
+
+//A value in RAM the reward follows. Each step earns scale times how much the value changed.
+struct RewardAddress {
+    uint16_t address = 0;
+    RewardEncoding encoding = REWARD_BYTE;
+    uint8_t digits = 3; //Only used by REWARD_DIGITS
+    float scale = 1;
+};
+
+//The episode ends once (mem[address] & mask) == value
+struct DoneCondition {
+    uint16_t address = 0;
+    uint8_t mask = 0xff;
+    uint8_t value = 0;
+};
+
+struct EnvConfig {
+    uint32_t clock_rate = CHIP8_DEFAULT_CLOCK;
+    QuirkProfile quirks = MODERN_QUIRKS;
+    uint32_t frame_skip = 4;     //60 Hz frames each step runs with the same action
+    float sticky_actions = 0;    //Chance each frame that the keys from the frame before are held instead of the new action
+    uint32_t boot_frames = 0;    //Frames run with no keys after loading the ROM, every episode starts from the state after them
+    uint32_t max_frames = 0;     //Frames an episode runs before it is cut off, 0 for no limit
+    std::vector<RewardAddress> rewards;
+    std::vector<DoneCondition> dones;  //Any one of them ends the episode
+
+    PixelFormat obs_format = PIXEL_GRAY8;
+    uint32_t obs_scale = 1;
+    uint32_t foreground = 0xffffffff;
+    uint32_t background = 0x000000ff;
+};
+
+//A vector of environments over one ROM for reinforcement learning. Every environment is a
+//machine in a BatchCore, so they all step in lockstep. Episodes start from a snapshot taken
+//once after boot, with RND seeded per episode, and an environment whose episode ended is put
+//back to it at the end of the same step.
+//
+//Observations are converted straight into the caller's buffer, getObservationSize() bytes per
+//environment one after the other, and everything is deterministic given the seeds and actions.
+class VecEnv {
+private:
+
+    void resetEnv(uint32_t index, uint64_t seed);
+    int64_t readReward(uint32_t index, const RewardAddress &reward) const;
+    bool isDone(uint32_t index) const;
+    void writeObservation(uint32_t index, uint8_t *observations) const;
+
+    EnvConfig m_config;
+    BatchCore m_core;
+    uint32_t m_frame_cycles;     //Instructions per frame, the clock rate over 60 rounded to the nearest
+    size_t m_obs_size;
+
+    MachineState m_boot;         //The snapshot every episode starts from
+    MachineState m_scratch;      //m_boot with an episode's seed put in
+    bool m_loaded;
+
+    std::vector<uint64_t> m_rng;       //Per environment, draws sticky actions and the seeds of later episodes
+    std::vector<uint16_t> m_keys;      //Keys each environment held during the last frame
+    std::vector<uint32_t> m_frames;    //Frames into the current episode
+    std::vector<int64_t>  m_values;    //Last value read from every reward address, m_config.rewards.size() per environment
+    std::vector<uint8_t>  m_finished;  //Episodes that ended during the current step
+
+public:
+
+    VecEnv(uint32_t size, const EnvConfig &config = EnvConfig());
+    ~VecEnv();
+
+    //Loads the ROM, runs the boot frames and takes the snapshot. reset has to be called after.
+    StatusCode loadRom(const std::string &path);
+
+    uint32_t getSize() const;
+    size_t getObservationSize() const; //Bytes per environment
+    const EnvConfig& getConfig() const;
+    uint32_t getEpisodeFrame(uint32_t index) const;
+
+    //Starts a new episode in every environment. seeds holds one per environment, observations
+    //getSize() * getObservationSize() bytes.
+    void reset(const uint64_t *seeds, uint8_t *observations);
+
+    //Runs every environment for frame_skip frames with its action held, a mask with bit k set if
+    //key k is down. rewards and dones get one entry per environment. An environment that is done
+    //has already been reset, so its observation is the first one of the next episode.
+    void step(const uint16_t *actions, uint8_t *observations, float *rewards, uint8_t *dones);
+};
+
+}
@@ -0,0 +1,86 @@
+#ifndef FISH8_H
+#define FISH8_H
+
+//C interface to the emulator, built as the libfish8 shared library so it can be loaded from
+//any language with a C FFI. Everything goes through an opaque handle and plain C types, and
+//nothing here changes layout without FISH8_ABI_VERSION going up.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #if defined(FISH8_BUILDING)
+        #define FISH8_API __declspec(dllexport)
+    #else
+        #define FISH8_API __declspec(dllimport)
+    #endif
+#else
+    #define FISH8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FISH8_ABI_VERSION    1
+#define FISH8_SCREEN_WIDTH   64
+#define FISH8_SCREEN_HEIGHT  32
+
+typedef struct fish8_machine fish8_machine;
+
+typedef enum fish8_status {
+    FISH8_OK = 0,
+    FISH8_INVALID_ARGUMENT = 1,  //A null handle or pointer
+    FISH8_INVALID_SIZE = 2,      //A ROM that is empty or doesn't fit in memory
+    FISH8_INVALID_STATE = 3,     //A snapshot this version can't read
+    FISH8_OUT_OF_MEMORY = 4
+} fish8_status;
+
+//Same order as fish::QuirkProfile
+typedef enum fish8_quirks {
+    FISH8_QUIRKS_MODERN = 0,
+    FISH8_QUIRKS_COSMAC_VIP = 1,
+    FISH8_QUIRKS_CHIP48 = 2,
+    FISH8_QUIRKS_SCHIP = 3
+} fish8_quirks;
+
+FISH8_API uint32_t fish8_abi_version(void); //FISH8_ABI_VERSION of the library that was loaded
+
+//Machines start out blank at the default clock rate, with timers driven by the instruction count
+//so every run is reproducible. Returns NULL if it couldn't be allocated.
+FISH8_API fish8_machine* fish8_create(void);
+FISH8_API void fish8_destroy(fish8_machine *machine);
+
+//Copies the ROM in and resets the machine, the buffer isn't needed afterwards
+FISH8_API fish8_status fish8_load_rom(fish8_machine *machine, const uint8_t *data, size_t size);
+
+FISH8_API void fish8_set_clock_rate(fish8_machine *machine, uint32_t hz);
+FISH8_API void fish8_set_quirks(fish8_machine *machine, fish8_quirks quirks);
+FISH8_API void fish8_set_seed(fish8_machine *machine, uint64_t seed); //Reseeds RND now and on every ROM load
+FISH8_API void fish8_set_keys(fish8_machine *machine, uint16_t keys); //Bit k set if key k is down, held until changed
+
+//Runs num instructions and returns the total run since the ROM was loaded
+FISH8_API uint64_t fish8_run_cycles(fish8_machine *machine, uint32_t num);
+FISH8_API int fish8_sound_active(const fish8_machine *machine);
+
+//The screen, one byte per pixel (0 or 1) row by row, FISH8_SCREEN_WIDTH * FISH8_SCREEN_HEIGHT
+//bytes. The pointer stays the same for the life of the machine and the pixels are updated in
+//place by every call that changes the screen, so it can be read without copying.
+FISH8_API const uint8_t* fish8_framebuffer(const fish8_machine *machine);
+
+//The machine's own screen rows, one bit per pixel with the leftmost pixel in the most
+//significant bit. Also stable for the life of the machine.
+FISH8_API const uint64_t* fish8_screen_rows(const fish8_machine *machine);
+FISH8_API uint64_t fish8_screen_hash(const fish8_machine *machine);
+
+//Writes a snapshot of the machine in the save state format if it fits in capacity, and returns
+//its size either way, so a first call with a NULL buffer gives the size to allocate. 0 if it
+//ran out of memory.
+FISH8_API size_t fish8_snapshot(const fish8_machine *machine, uint8_t *buffer, size_t capacity);
+FISH8_API fish8_status fish8_restore(fish8_machine *machine, const uint8_t *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,614 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "BatchCore.hpp"
+#include "Chip8.hpp"
+#include "Fork.hpp"
+#include "Interpreter.hpp"
+#include "Log.hpp"
+#include "Rewind.hpp"
+#include "SaveState.hpp"
+#include "ScreenConvert.hpp"
+
+//Microbenchmarks for the instruction handlers, decoding, DRW, screen conversion, save states, rewind, forking and the batch core, plus
+//whole-ROM throughput for every execution core. Results are printed as CSV or JSON so they can be compared
+//across commits.
+
+struct Result {
+    std::string group;
+    std::string name;
+    std::string core;
+    uint64_t    iterations;
+    double      ns_per_op;
+};
+
+struct Options {
+    std::string roms_dir = "roms";
+    std::string only;                //Only run one group if set
+    std::string output_path;         //Prints to stdout if empty
+    bool        json = false;
+    uint64_t    iterations = 1000000; //Per microbenchmark
+    uint64_t    cycles = 5000000;     //Per ROM and core
+    uint32_t    repeats = 5;          //The fastest run is reported
+};
+
+static const char *const core_names[] = {"interpreter", "threaded", "jit"};
+
+//Runs body(iterations) a few times and returns the fastest time per iteration in nanoseconds
+static double measure(uint64_t iterations, uint32_t repeats, const std::function<void(uint64_t)> &body) {
+    double best = 0;
+
+    for(uint32_t r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if(r == 0 || ns < best) { best = ns; }
+    }
+
+    return best / iterations;
+}
+
+//A representative instruction word for every handler, in the same order as the Opcode enum
+static const struct { const char *name; uint16_t instr; } handler_cases[fish::OP_COUNT] = {
+    {"NOP",    0x0000}, {"CLS",    0x00e0}, {"RET",    0x00ee}, {"JP_1",   0x1200},
+    {"CALL",   0x2200}, {"SE_3",   0x3105}, {"SNE_4",  0x4105}, {"SE_5",   0x5120},
+    {"LD_6",   0x6105}, {"ADD_7",  0x7105}, {"LD_8",   0x8120}, {"OR",     0x8121},
+    {"AND",    0x8122}, {"XOR",    0x8123}, {"ADD_8",  0x8124}, {"SUB",    0x8125},
+    {"SHR",    0x8126}, {"SUBN",   0x8127}, {"SHL",    0x812e}, {"SNE_9",  0x9120},
+    {"LD_A",   0xa300}, {"JP_B",   0xb200}, {"RND",    0xc1ff}, {"DRW",    0xd125},
+    {"SKP",    0xe19e}, {"SKNP",   0xe1a1}, {"LD_F07", 0xf107}, {"LD_F0A", 0xf10a},
+    {"LD_F15", 0xf115}, {"LD_F18", 0xf118}, {"ADD_F",  0xf11e}, {"LD_F29", 0xf129},
+    {"LD_F33", 0xf133}, {"LD_F55", 0xf555}, {"LD_F65", 0xf565}
+};
+
+//Machine state for calling handlers directly, reset before every call so CALL, RET and
+//ADD_F can't run off the end of the stack or memory
+struct Bench {
+    fish::Interpreter interpreter;
+    fish::Registers regs = {};
+    uint8_t mem[fish::CHIP8_MEM_SIZE] = {};
+    uint64_t screen[fish::CHIP8_SCREEN_HEIGHT] = {};
+    uint16_t stack[fish::CHIP8_STACK_MAX] = {};
+    bool keys[fish::CHIP8_NUM_KEYS] = {};
+
+    Bench() {
+        for(uint32_t i = 0; i < fish::CHIP8_V_REG_COUNT; i++) { regs.V[i] = static_cast<uint8_t>(i * 7); }
+        memset(mem + 0x300, 0xa5, 0x100);
+    }
+
+    double run(uint8_t opcode, uint16_t operands, const Options &options) {
+        fish::InstructionFunc func = interpreter.m_instructions[opcode];
+
+        return measure(options.iterations, options.repeats, [&](uint64_t n) {
+            for(uint64_t i = 0; i < n; i++) {
+                regs.PC = 0x200;
+                regs.SP = 1;
+                regs.I  = 0x300;
+                func(operands, regs, mem, screen, stack, keys);
+            }
+        });
+    }
+};
+
+static void benchHandlers(const Options &options, std::vector<Result> &results) {
+    Bench bench;
+
+    for(uint32_t op = 0; op < fish::OP_COUNT; op++) {
+        //Go through decode so a table that got out of order shows up as a mismatch here
+        bench.interpreter.decode(handler_cases[op].instr);
+        if(bench.interpreter.m_opcode != op) {
+            LOG_ERROR("[BCH]: %s decodes to opcode %d instead of %d", handler_cases[op].name, bench.interpreter.m_opcode, op);
+            continue;
+        }
+
+        double ns = bench.run(bench.interpreter.m_opcode, bench.interpreter.m_operands, options);
+        results.push_back({"handler", handler_cases[op].name, "", options.iterations, ns});
+    }
+}
+
+static void benchDecode(const Options &options, std::vector<Result> &results) {
+    fish::Interpreter interpreter;
+    uint32_t sink = 0;
+
+    //Every possible instruction word, including invalid ones
+    double ns = measure(options.iterations, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            interpreter.decode(static_cast<uint16_t>(i));
+            sink += interpreter.m_opcode;
+        }
+    });
+    results.push_back({"decode", "decode", "", options.iterations, ns});
+
+    //Lookups that hit the decode cache, the common case while running
+    uint8_t mem[fish::CHIP8_MEM_SIZE];
+    for(uint32_t i = 0; i < fish::CHIP8_MEM_SIZE; i++) { mem[i] = static_cast<uint8_t>(i * 31); }
+
+    ns = measure(options.iterations, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            sink += interpreter.fetch(mem, static_cast<uint16_t>((i * 2) & (fish::CHIP8_MEM_SIZE - 1))).opcode;
+        }
+    });
+    results.push_back({"decode", "cached_fetch", "", options.iterations, ns});
+
+    //Keeps the loops from being optimized away
+    if(sink == 0xffffffff) { fmt::printf("\n"); }
+}
+
+static void benchDraw(const Options &options, std::vector<Result> &results) {
+    static const struct { const char *name; uint8_t x, y; } positions[] = {
+        {"aligned",   0,  0},
+        {"unaligned", 13, 7},
+        {"wrap_x",    60, 4},
+        {"wrap_y",    8,  28},
+        {"wrap_xy",   60, 28}
+    };
+    static const uint8_t heights[] = {1, 5, 8, 15};
+
+    Bench bench;
+
+    for(const auto &position : positions) {
+        for(uint8_t height : heights) {
+            //DRW V0, V1, n with the position in V0 and V1
+            bench.regs.V[0] = position.x;
+            bench.regs.V[1] = position.y;
+
+            double ns = bench.run(fish::OP_DRW, static_cast<uint16_t>(0x010 | height), options);
+            results.push_back({"drw", fmt::sprintf("%s_h%d", position.name, height), "", options.iterations, ns});
+        }
+    }
+}
+
+static void benchConvert(const Options &options, std::vector<Result> &results) {
+    static const char *const format_names[] = {"rgba8", "rgb8", "gray8"};
+    static const char *const level_names[] = {"scalar", "sse2", "avx2"};
+    static const uint32_t scales[] = {1, 4, 10};
+
+    //A whole frame is a few thousand pixels, so there are fewer iterations than for single instructions
+    uint64_t frames = std::max<uint64_t>(1, options.iterations / 1000);
+    uint64_t rows[fish::CHIP8_SCREEN_HEIGHT];
+    for(uint32_t y = 0; y < fish::CHIP8_SCREEN_HEIGHT; y++) { rows[y] = 0x9e3779b97f4a7c15 * (y + 1); }
+
+    const uint32_t foreground = 0xffffffff;
+    const uint32_t background = 0x000000ff;
+
+    //The per-pixel loop the frontend used to fill its RGBA texture with
+    std::vector<uint32_t> texture(fish::CHIP8_SCREEN_PIXELS);
+    double ns = measure(frames, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            rows[i & (fish::CHIP8_SCREEN_HEIGHT - 1)] ^= 1;
+
+            for(uint32_t y = 0; y < fish::CHIP8_SCREEN_HEIGHT; y++) {
+                for(uint32_t x = 0; x < fish::CHIP8_SCREEN_WIDTH; x++) {
+                    texture[x + y * fish::CHIP8_SCREEN_WIDTH] = (rows[y] >> (fish::CHIP8_SCREEN_WIDTH - 1 - x)) & 1 ? foreground : background;
+                }
+            }
+        }
+    });
+    results.push_back({"convert", "loop_rgba8_x1", "", frames, ns});
+
+    fish::SimdLevel best = fish::detectSimdLevel();
+
+    for(uint32_t format = fish::PIXEL_RGBA8; format <= fish::PIXEL_GRAY8; format++) {
+        for(uint32_t scale : scales) {
+            std::vector<uint8_t> out(fish::convertedScreenSize(static_cast<fish::PixelFormat>(format), scale));
+
+            for(uint32_t level = fish::SIMD_SCALAR; level <= best; level++) {
+                ns = measure(frames, options.repeats, [&](uint64_t n) {
+                    for(uint64_t i = 0; i < n; i++) {
+                        rows[i & (fish::CHIP8_SCREEN_HEIGHT - 1)] ^= 1;
+                        fish::convertScreen(rows, fish::CHIP8_SCREEN_HEIGHT, out.data(), static_cast<fish::PixelFormat>(format), scale,
+                                            foreground, background, static_cast<fish::SimdLevel>(level));
+                    }
+                });
+                results.push_back({"convert", fmt::sprintf("%s_x%d", format_names[format], scale), level_names[level], frames, ns});
+            }
+        }
+    }
+}
+
+static void benchState(const Options &options, std::vector<Result> &results) {
+    fish::Chip8 emu;
+    fish::MachineState state;
+    const bool keys[fish::CHIP8_NUM_KEYS] = {};
+
+    //A machine that has been running for a while, with memory written by the program
+    emu.saveState(state);
+    for(uint32_t i = 0; i < fish::CHIP8_MEM_SIZE; i++) { state.mem[i] = static_cast<uint8_t>(i * 31); }
+    emu.loadState(state);
+    emu.cycle(1000, keys);
+
+    double ns = measure(options.iterations, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            emu.saveState(state);
+        }
+    });
+    results.push_back({"state", "save_state", "", options.iterations, ns});
+
+    //Loading the state the machine is already in, like a rewind a frame or two back
+    ns = measure(options.iterations, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            emu.loadState(state);
+        }
+    });
+    results.push_back({"state", "load_state", "", options.iterations, ns});
+
+    //Serialization allocates, so it runs fewer times
+    uint64_t files = std::max<uint64_t>(1, options.iterations / 100);
+    size_t sink = 0;
+
+    ns = measure(files, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            std::vector<uint8_t> data = fish::serializeState(state);
+            sink += fish::deserializeState(data.data(), data.size(), state) == fish::OK;
+        }
+    });
+    results.push_back({"state", "serialize_roundtrip", "", files, ns});
+
+    //Keeps the loops from being optimized away
+    if(sink == 0) { fmt::printf("\n"); }
+}
+
+static void benchRewind(const Options &options, std::vector<Result> &results) {
+    //Ten seconds of frames from a program that draws and stores to memory every loop
+    static constexpr uint32_t FRAMES = 10 * fish::CHIP8_TIMER_FREQ;
+    static const uint16_t program[] = {
+        0x6000, 0x6100, 0xf029, 0xd015, 0x7001, 0x7103, 0xa400, 0xf255, 0x1204
+    };
+
+    fish::Chip8 emu;
+    std::vector<fish::MachineState> frames(FRAMES);
+    const bool keys[fish::CHIP8_NUM_KEYS] = {};
+
+    memset(frames.data(), 0, frames.size() * sizeof(fish::MachineState));
+    emu.saveState(frames[0]);
+    for(uint32_t i = 0; i < std::size(program); i++) {
+        frames[0].mem[0x200 + i * 2] = program[i] >> 8;
+        frames[0].mem[0x201 + i * 2] = program[i] & 0xff;
+    }
+    emu.loadState(frames[0]);
+
+    for(fish::MachineState &frame : frames) {
+        emu.saveState(frame);
+        emu.cycle(fish::CHIP8_DEFAULT_CLOCK / fish::CHIP8_TIMER_FREQ, keys);
+    }
+
+    fish::RewindBuffer rewind;
+    fish::MachineState state;
+    rewind.setCapacity(FRAMES, fish::CHIP8_TIMER_FREQ);
+
+    //Per frame, so the numbers compare directly to a 16.7 ms frame
+    double ns = measure(FRAMES, options.repeats, [&](uint64_t n) {
+        rewind.clear();
+        for(uint64_t i = 0; i < n; i++) {
+            rewind.push(frames[i]);
+        }
+    });
+    results.push_back({"rewind", "record_frame", "", FRAMES, ns});
+
+    //Popping empties the buffer, so it is refilled outside of the timed part before every repeat
+    double best = 0;
+
+    for(uint32_t r = 0; r < options.repeats; r++) {
+        rewind.clear();
+        for(const fish::MachineState &frame : frames) { rewind.push(frame); }
+
+        auto start = std::chrono::steady_clock::now();
+        while(rewind.pop(state)) { }
+        double total = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if(r == 0 || total < best) { best = total; }
+    }
+    results.push_back({"rewind", "rewind_frame", "", FRAMES, best / FRAMES});
+}
+
+static void benchFork(const Options &options, std::vector<Result> &results) {
+    //Same program as the rewind group, it draws and stores to memory every loop
+    static const uint16_t program[] = {
+        0x6000, 0x6100, 0xf029, 0xd015, 0x7001, 0x7103, 0xa400, 0xf255, 0x1204
+    };
+    static constexpr uint32_t FRAME = fish::CHIP8_DEFAULT_CLOCK / fish::CHIP8_TIMER_FREQ;
+
+    fish::Chip8 emu;
+    fish::MachineState state;
+    emu.saveState(state);
+    for(uint32_t i = 0; i < std::size(program); i++) {
+        state.mem[0x200 + i * 2] = program[i] >> 8;
+        state.mem[0x201 + i * 2] = program[i] & 0xff;
+    }
+    emu.loadState(state);
+
+    const bool keys[fish::CHIP8_NUM_KEYS] = {};
+    fish::Searcher searcher;
+    fish::ForkState root = searcher.capture(emu);
+    std::vector<fish::ForkState> children(256);
+
+    double ns = measure(options.iterations, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            children[i & 0xff] = root.fork();
+        }
+    });
+    results.push_back({"fork", "fork", "", options.iterations, ns});
+
+    //Running a frame costs far more than a fork, so the frame benchmarks get fewer iterations
+    uint64_t frames = std::max<uint64_t>(1, options.iterations / 10);
+
+    //Expanding a search node, a fork and a frame from it
+    ns = measure(frames, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            children[i & 0xff] = root.fork();
+            searcher.run(children[i & 0xff], FRAME, keys);
+        }
+    });
+    results.push_back({"fork", "fork_frame", "", frames, ns});
+
+    //The same with a whole state loaded every time
+    ns = measure(frames, options.repeats, [&](uint64_t n) {
+        for(uint64_t i = 0; i < n; i++) {
+            emu.loadState(state);
+            emu.cycle(FRAME, keys);
+        }
+    });
+    results.push_back({"fork", "load_state_frame", "", frames, ns});
+}
+
+static void benchBatch(const Options &options, std::vector<Result> &results) {
+    //A loop of register-only instructions. Every machine starts with V2 = 0 in "uniform", so they all
+    //take the same path, and with V2 set to its index in "diverged", so SE sends them different ways.
+    static constexpr uint32_t MACHINES = 256;
+    static constexpr uint32_t STEPS = 1000;
+    static const uint16_t program[] = {
+        0x6000, 0x6105, 0x8014, 0x8024, 0x8106, 0x7103, 0x3000, 0x1204, 0xf015, 0x1204
+    };
+
+    fish::Chip8 emu;
+    fish::MachineState state;
+    emu.saveState(state);
+    for(uint32_t i = 0; i < std::size(program); i++) {
+        state.mem[0x200 + i * 2] = program[i] >> 8;
+        state.mem[0x201 + i * 2] = program[i] & 0xff;
+    }
+
+    const std::vector<uint16_t> keys(MACHINES, 0);
+    const bool no_keys[fish::CHIP8_NUM_KEYS] = {};
+
+    for(uint32_t diverged = 0; diverged <= 1; diverged++) {
+        const char *name = diverged ? "diverged" : "uniform";
+
+        //The same machines one at a time, for comparison
+        std::vector<fish::Chip8> machines(MACHINES);
+        for(uint32_t i = 0; i < MACHINES; i++) {
+            state.regs.V[2] = diverged ? static_cast<uint8_t>(i) : 0;
+            machines[i].setIdleSkipping(false);
+            machines[i].loadState(state);
+        }
+
+        //Per machine and cycle, so the numbers compare directly to the rom group
+        double ns = measure(STEPS, options.repeats, [&](uint64_t n) {
+            for(fish::Chip8 &machine : machines) { machine.cycle(static_cast<uint32_t>(n), no_keys); }
+        });
+        results.push_back({"batch", name, "chip8", STEPS * MACHINES, ns / MACHINES});
+
+        for(fish::SimdLevel level : {fish::SIMD_SCALAR, fish::SIMD_AVX2}) {
+            fish::BatchCore batch(MACHINES);
+            batch.setSimdLevel(level);
+            if(batch.getSimdLevel() != level) { continue; }
+
+            for(uint32_t i = 0; i < MACHINES; i++) {
+                state.regs.V[2] = diverged ? static_cast<uint8_t>(i) : 0;
+                batch.loadState(i, state);
+            }
+
+            ns = measure(STEPS, options.repeats, [&](uint64_t n) {
+                batch.cycle(static_cast<uint32_t>(n), keys.data());
+            });
+            results.push_back({"batch", name, level == fish::SIMD_AVX2 ? "avx2" : "scalar", STEPS * MACHINES, ns / MACHINES});
+        }
+    }
+}
+
+static void benchRoms(const Options &options, std::vector<Result> &results) {
+    namespace fs = std::filesystem;
+
+    if(!fs::is_directory(options.roms_dir)) {
+        LOG_ERROR("[BCH]: %s is not a directory", options.roms_dir);
+        return;
+    }
+
+    std::vector<fs::path> roms;
+    for(const auto &entry : fs::recursive_directory_iterator(options.roms_dir)) {
+        std::string ext = entry.path().extension().string();
+        if(entry.is_regular_file() && (ext == ".ch8" || ext == ".c8" || ext == ".rom")) {
+            roms.push_back(entry.path());
+        }
+    }
+    std::sort(roms.begin(), roms.end());
+
+    const bool keys[fish::CHIP8_NUM_KEYS] = {};
+
+    for(const fs::path &rom : roms) {
+        for(uint32_t core = fish::INTERPRETER_CORE; core <= fish::JIT_CORE; core++) {
+            double best = 0;
+
+            //Every run starts from a freshly loaded ROM so they all execute the same instructions
+            for(uint32_t r = 0; r < options.repeats; r++) {
+                fish::Chip8 emu;
+                if(emu.loadRom(rom.string()) != fish::OK) { break; }
+
+                emu.setTimerMode(fish::CYCLE_TIMERS);
+                emu.setCore(static_cast<fish::CoreType>(core));
+
+                auto start = std::chrono::steady_clock::now();
+                for(uint64_t done = 0; done < options.cycles; done += fish::CHIP8_DEFAULT_CLOCK) {
+                    emu.cycle(static_cast<uint32_t>(std::min<uint64_t>(fish::CHIP8_DEFAULT_CLOCK, options.cycles - done)), keys);
+                }
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+                if(r == 0 || ns < best) { best = ns; }
+            }
+
+            if(best > 0) {
+                results.push_back({"rom", fs::relative(rom, options.roms_dir).generic_string(), core_names[core], options.cycles, best / options.cycles});
+            }
+        }
+    }
+}
+
+static std::string csvField(const std::string &text) {
+    if(text.find_first_of(",\"") == std::string::npos) { return text; }
+
+    std::string quoted = "\"";
+    for(char c : text) {
+        if(c == '"') { quoted += '"'; }
+        quoted += c;
+    }
+
+    return quoted + "\"";
+}
+
+static std::string jsonString(const std::string &text) {
+    std::string escaped = "\"";
+    for(char c : text) {
+        if(c == '"' || c == '\\') { escaped += '\\'; }
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+static void writeResults(FILE *file, const std::vector<Result> &results, bool json) {
+    if(json) {
+        fmt::fprintf(file, "[\n");
+        for(size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            fmt::fprintf(file, "  {\"group\": %s, \"name\": %s, \"core\": %s, \"iterations\": %llu, \"ns_per_op\": %.3f, \"ops_per_sec\": %.0f}%s\n",
+                         jsonString(r.group), jsonString(r.name), jsonString(r.core), static_cast<unsigned long long>(r.iterations),
+                         r.ns_per_op, 1e9 / r.ns_per_op, i + 1 < results.size() ? "," : "");
+        }
+        fmt::fprintf(file, "]\n");
+    } else {
+        fmt::fprintf(file, "group,name,core,iterations,ns_per_op,ops_per_sec\n");
+        for(const Result &r : results) {
+            fmt::fprintf(file, "%s,%s,%s,%llu,%.3f,%.0f\n", r.group, csvField(r.name), r.core,
+                         static_cast<unsigned long long>(r.iterations), r.ns_per_op, 1e9 / r.ns_per_op);
+        }
+    }
+}
+
+static void printHelp(const char *name) {
+    fmt::printf("Usage: %s [options...]\n\nOptions:\n"
+                " %-22s - Output format, csv (default) or json\n"
+                " %-22s - Write the results to a file instead of stdout\n"
+                " %-22s - Only run handler, decode, drw, convert, state, rewind, fork, batch, or rom benchmarks\n"
+                " %-22s - Iterations per microbenchmark (default 1000000)\n"
+                " %-22s - Instructions per ROM and core (default 5000000)\n"
+                " %-22s - Runs per benchmark, the fastest is reported (default 5)\n"
+                " %-22s - Directory searched for ROMs (default roms)\n"
+                " %-22s - Shows this help message\n",
+                name, "--format <csv|json>", "-o --output <file>", "--only <group>", "-n --iterations <n>",
+                "-c --cycles <n>", "--repeats <n>", "--roms <dir>", "-h --help");
+}
+
+//Parses the count given to an option, the whole text has to be a number that fits in T. Zero
+//is taken as one.
+template<typename T>
+static bool parseCount(const char *option, const char *text, T &value) {
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long parsed = strtoull(text, &end, 10);
+
+    //strtoull takes negative numbers and wraps them around
+    if(end == text || *end != '\0' || errno == ERANGE || strchr(text, '-') != nullptr || parsed > std::numeric_limits<T>::max()) {
+        LOG_ERROR("[BCH]: Invalid value %s for %s", text, option);
+        return false;
+    }
+
+    value = std::max<T>(1, static_cast<T>(parsed));
+    return true;
+}
+
+static bool parseArgs(int argc, char **argv, Options &options) {
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(strcmp(argv[i], "--format") == 0 && has_value) {
+            std::string format = argv[++i];
+            if(format != "csv" && format != "json") { LOG_ERROR("[BCH]: Unknown format %s", format); return false; }
+            options.json = format == "json";
+        } else if((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && has_value) {
+            options.output_path = argv[++i];
+        } else if(strcmp(argv[i], "--only") == 0 && has_value) {
+            static const char *const groups[] = {"handler", "decode", "drw", "convert", "state", "rewind", "fork", "batch", "rom"};
+            options.only = argv[++i];
+            if(std::find(std::begin(groups), std::end(groups), options.only) == std::end(groups)) {
+                LOG_ERROR("[BCH]: Unknown group %s", options.only);
+                return false;
+            }
+        } else if((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--iterations") == 0) && has_value) {
+            if(!parseCount(argv[i], argv[i + 1], options.iterations)) { return false; }
+            i++;
+        } else if((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--cycles") == 0) && has_value) {
+            if(!parseCount(argv[i], argv[i + 1], options.cycles)) { return false; }
+            i++;
+        } else if(strcmp(argv[i], "--repeats") == 0 && has_value) {
+            if(!parseCount(argv[i], argv[i + 1], options.repeats)) { return false; }
+            i++;
+        } else if(strcmp(argv[i], "--roms") == 0 && has_value) {
+            options.roms_dir = argv[++i];
+        } else if((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0)) {
+            printHelp(argv[0]);
+            std::exit(0);
+        } else {
+            LOG_ERROR("[BCH]: Unknown option or missing value %s", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if(!parseArgs(argc, argv, options)) {
+        printHelp(argv[0]);
+        return 1;
+    }
+
+    std::vector<Result> results;
+
+    if(options.only.empty() || options.only == "handler") { benchHandlers(options, results); }
+    if(options.only.empty() || options.only == "decode")  { benchDecode(options, results); }
+    if(options.only.empty() || options.only == "drw")     { benchDraw(options, results); }
+    if(options.only.empty() || options.only == "convert") { benchConvert(options, results); }
+    if(options.only.empty() || options.only == "state")   { benchState(options, results); }
+    if(options.only.empty() || options.only == "rewind")  { benchRewind(options, results); }
+    if(options.only.empty() || options.only == "fork")    { benchFork(options, results); }
+    if(options.only.empty() || options.only == "batch")   { benchBatch(options, results); }
+    if(options.only.empty() || options.only == "rom")     { benchRoms(options, results); }
+
+    FILE *file = stdout;
+    if(!options.output_path.empty()) {
+        file = fopen(options.output_path.c_str(), "w");
+        if(file == nullptr) {
+            LOG_ERROR("[BCH]: Could not open %s", options.output_path);
+            return 1;
+        }
+    }
+
+    writeResults(file, results, options.json);
+
+    if(file != stdout) {
+        fclose(file);
+    }
+
+    return 0;
+}
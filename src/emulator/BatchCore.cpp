@@ -0,0 +1,579 @@
+#include "BatchCore.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Chip8.hpp"
+#include "Quirks.hpp"
+
+//Same AVX2 setup as ScreenConvert.cpp, the kernels are only called if detectSimdLevel() finds it
+#if defined(__x86_64__) || defined(_M_X64)
+#define FISH_SIMD_X64 1
+#include <immintrin.h>
+#else
+#define FISH_SIMD_X64 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FISH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FISH_TARGET_AVX2
+#endif
+
+namespace fish {
+
+//How many steps the machines of a block run on their own once they have diverged. Every time
+//they are still apart afterwards this doubles, up to the maximum.
+static constexpr uint32_t DIVERGED_STEPS = 16;
+static constexpr uint32_t MAX_DIVERGED_STEPS = 1024;
+
+//One block of machines, as handed to the AVX2 kernels
+struct BatchBlock {
+    uint8_t  *V;           //V0 of the first machine, Vr is r * stride bytes further
+    uint32_t  stride;
+    uint16_t *I;
+    uint16_t *PC;
+    uint16_t *last_pc;
+    uint8_t  *DT;
+    uint8_t  *ST;
+    uint32_t *timer_accum;
+    const uint8_t *waiting;
+    const uint8_t *mem;    //Memory of the first machine
+    uint32_t  count;       //Machines in the block, the rest are padding
+};
+
+#if FISH_SIMD_X64
+
+//Widens the 32 bytes of v into two vectors of 16-bit values, for the first and last 16 machines
+FISH_TARGET_AVX2 static inline void widenBytes(__m256i v, __m256i &lo, __m256i &hi) {
+    lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+    hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+}
+
+//Fetches the instruction every machine in the block is about to run. Returns true and sets
+//instr if they are all the same and none of them is waiting for a key.
+FISH_TARGET_AVX2 static bool fetchUniformAvx2(const BatchBlock &block, uint16_t &instr) {
+    const uint32_t valid = block.count == BATCH_BLOCK ? ~0u : (1u << block.count) - 1;
+
+    uint32_t running = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.waiting)), _mm256_setzero_si256()));
+    if((running | ~valid) != ~0u) { return false; }
+
+    //Gathers the two bytes at PC from eight machines at a time. The second byte of an instruction at
+    //0xfff wraps around to the start of memory, which a gather can't do, so those are left to runLane.
+    const __m256i pc_mask = _mm256_set1_epi32(CHIP8_MEM_SIZE - 1);
+    const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i words[BATCH_BLOCK / 8];
+    uint32_t at_end = 0;
+
+    for(uint32_t k = 0; k < BATCH_BLOCK / 8; k++) {
+        __m256i pc = _mm256_and_si256(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block.PC + k * 8))), pc_mask);
+        __m256i offsets = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(lane_offsets, _mm256_set1_epi32(k * 8)), 12), pc);
+        __m256i bytes = _mm256_i32gather_epi32(reinterpret_cast<const int*>(block.mem), offsets, 1);
+
+        words[k] = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(bytes, _mm256_set1_epi32(0xff)), 8), _mm256_and_si256(_mm256_srli_epi32(bytes, 8), _mm256_set1_epi32(0xff)));
+        at_end |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(pc, pc_mask)))) << (k * 8);
+    }
+
+    if(at_end & valid) { return false; }
+
+    const __m256i first = _mm256_set1_epi32(_mm256_cvtsi256_si32(words[0]));
+    uint32_t equal = 0;
+
+    for(uint32_t k = 0; k < BATCH_BLOCK / 8; k++) {
+        equal |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(words[k], first)))) << (k * 8);
+    }
+
+    instr = static_cast<uint16_t>(_mm256_cvtsi256_si32(words[0]));
+    return (equal | ~valid) == ~0u;
+}
+
+//Runs one decoded instruction on every machine in the block. Same semantics as the functions in
+//Instruction.cpp, including which write wins when x is F. Returns false without changing anything
+//for instructions that have to run machine by machine.
+template<typename Q>
+FISH_TARGET_AVX2 static bool stepUniformAvx2(const BatchBlock &block, uint8_t opcode, uint16_t operands) {
+    const uint8_t x = (operands >> 8) & 0xf;
+    const uint8_t y = (operands >> 4) & 0xf;
+    const uint8_t nn = operands & 0xff;
+
+    __m256i *const vx = reinterpret_cast<__m256i*>(block.V + x * block.stride);
+    __m256i *const vy = reinterpret_cast<__m256i*>(block.V + y * block.stride);
+    __m256i *const vf = reinterpret_cast<__m256i*>(block.V + 0xf * block.stride);
+    __m256i *const pc_lo = reinterpret_cast<__m256i*>(block.PC);
+    __m256i *const pc_hi = reinterpret_cast<__m256i*>(block.PC + 16);
+    __m256i *const i_lo = reinterpret_cast<__m256i*>(block.I);
+    __m256i *const i_hi = reinterpret_cast<__m256i*>(block.I + 16);
+
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i all = _mm256_set1_epi8(-1);
+
+    __m256i pc[2];
+    pc[0] = _mm256_and_si256(_mm256_loadu_si256(pc_lo), _mm256_set1_epi16(CHIP8_MEM_SIZE - 1));
+    pc[1] = _mm256_and_si256(_mm256_loadu_si256(pc_hi), _mm256_set1_epi16(CHIP8_MEM_SIZE - 1));
+
+    __m256i skip = _mm256_setzero_si256(); //0xff for every machine that skips the next instruction
+    bool jump = false;
+    __m256i target[2];
+
+    switch(opcode) {
+        case OP_NOP : break;
+
+        case OP_JP_1 :
+            target[0] = target[1] = _mm256_set1_epi16(static_cast<int16_t>(operands - 2));
+            jump = true;
+        break;
+
+        case OP_SE_3 : skip = _mm256_cmpeq_epi8(_mm256_loadu_si256(vx), _mm256_set1_epi8(nn)); break;
+        case OP_SNE_4 : skip = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(vx), _mm256_set1_epi8(nn)), all); break;
+        case OP_SE_5 : skip = _mm256_cmpeq_epi8(_mm256_loadu_si256(vx), _mm256_loadu_si256(vy)); break;
+        case OP_SNE_9 : skip = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(vx), _mm256_loadu_si256(vy)), all); break;
+
+        case OP_LD_6 : _mm256_storeu_si256(vx, _mm256_set1_epi8(nn)); break;
+        case OP_ADD_7 : _mm256_storeu_si256(vx, _mm256_add_epi8(_mm256_loadu_si256(vx), _mm256_set1_epi8(nn))); break;
+        case OP_LD_8 : _mm256_storeu_si256(vx, _mm256_loadu_si256(vy)); break;
+
+        case OP_OR :
+        case OP_AND :
+        case OP_XOR : {
+            __m256i a = _mm256_loadu_si256(vx);
+            __m256i b = _mm256_loadu_si256(vy);
+            __m256i result = opcode == OP_OR ? _mm256_or_si256(a, b) : opcode == OP_AND ? _mm256_and_si256(a, b) : _mm256_xor_si256(a, b);
+            _mm256_storeu_si256(vx, result);
+            if constexpr(Q::reset_vf) { _mm256_storeu_si256(vf, _mm256_setzero_si256()); }
+        } break;
+
+        case OP_ADD_8 : {
+            __m256i a = _mm256_loadu_si256(vx);
+            __m256i sum = _mm256_add_epi8(a, _mm256_loadu_si256(vy));
+            __m256i no_carry = _mm256_cmpeq_epi8(_mm256_max_epu8(sum, a), sum); //sum >= a
+            _mm256_storeu_si256(vf, _mm256_andnot_si256(no_carry, ones));
+            _mm256_storeu_si256(vx, sum);
+        } break;
+
+        case OP_SUB : {
+            __m256i a = _mm256_loadu_si256(vx);
+            __m256i b = _mm256_loadu_si256(vy);
+            __m256i not_greater = _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b); //a <= b
+            _mm256_storeu_si256(vf, _mm256_andnot_si256(not_greater, ones));
+            _mm256_storeu_si256(vx, _mm256_sub_epi8(a, b));
+        } break;
+
+        case OP_SUBN : {
+            __m256i a = _mm256_loadu_si256(vx);
+            __m256i b = _mm256_loadu_si256(vy);
+            __m256i not_greater = _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a); //b <= a
+            _mm256_storeu_si256(vf, _mm256_and_si256(not_greater, ones));
+            _mm256_storeu_si256(vx, _mm256_sub_epi8(b, a));
+        } break;
+
+        case OP_SHR : {
+            __m256i value = _mm256_loadu_si256(Q::shift_vy ? vy : vx);
+            __m256i flag = _mm256_and_si256(value, ones);
+            __m256i shifted = _mm256_and_si256(_mm256_srli_epi16(value, 1), _mm256_set1_epi8(0x7f));
+
+            if constexpr(Q::shift_vy) {
+                _mm256_storeu_si256(vx, shifted);
+                _mm256_storeu_si256(vf, flag);
+            } else {
+                _mm256_storeu_si256(vf, flag);
+                _mm256_storeu_si256(vx, shifted);
+            }
+        } break;
+
+        case OP_SHL : {
+            __m256i value = _mm256_loadu_si256(Q::shift_vy ? vy : vx);
+            __m256i flag = _mm256_and_si256(_mm256_srli_epi16(value, 7), ones);
+            __m256i shifted = _mm256_add_epi8(value, value);
+
+            if constexpr(Q::shift_vy) {
+                _mm256_storeu_si256(vx, shifted);
+                _mm256_storeu_si256(vf, flag);
+            } else {
+                _mm256_storeu_si256(vf, flag);
+                _mm256_storeu_si256(vx, shifted);
+            }
+        } break;
+
+        case OP_LD_A : {
+            __m256i value = _mm256_set1_epi16(static_cast<int16_t>(operands));
+            _mm256_storeu_si256(i_lo, value);
+            _mm256_storeu_si256(i_hi, value);
+        } break;
+
+        case OP_JP_B : {
+            __m256i base = _mm256_set1_epi16(static_cast<int16_t>(operands - 2));
+            widenBytes(_mm256_loadu_si256(Q::jump_vx ? vx : reinterpret_cast<__m256i*>(block.V)), target[0], target[1]);
+            target[0] = _mm256_add_epi16(target[0], base);
+            target[1] = _mm256_add_epi16(target[1], base);
+            jump = true;
+        } break;
+
+        case OP_LD_F07 : _mm256_storeu_si256(vx, _mm256_loadu_si256(reinterpret_cast<__m256i*>(block.DT))); break;
+        case OP_LD_F15 : _mm256_storeu_si256(reinterpret_cast<__m256i*>(block.DT), _mm256_loadu_si256(vx)); break;
+        case OP_LD_F18 : _mm256_storeu_si256(reinterpret_cast<__m256i*>(block.ST), _mm256_loadu_si256(vx)); break;
+
+        case OP_ADD_F : {
+            __m256i lo, hi;
+            widenBytes(_mm256_loadu_si256(vx), lo, hi);
+            _mm256_storeu_si256(i_lo, _mm256_add_epi16(_mm256_loadu_si256(i_lo), lo));
+            _mm256_storeu_si256(i_hi, _mm256_add_epi16(_mm256_loadu_si256(i_hi), hi));
+        } break;
+
+        case OP_LD_F29 : {
+            __m256i lo, hi;
+            widenBytes(_mm256_loadu_si256(vx), lo, hi);
+            _mm256_storeu_si256(i_lo, _mm256_mullo_epi16(lo, _mm256_set1_epi16(5)));
+            _mm256_storeu_si256(i_hi, _mm256_mullo_epi16(hi, _mm256_set1_epi16(5)));
+        } break;
+
+        default : return false;
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(block.last_pc), pc[0]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(block.last_pc + 16), pc[1]);
+
+    if(jump) {
+        pc[0] = target[0];
+        pc[1] = target[1];
+    }
+
+    //Every instruction moves PC on by 2, skips by another 2
+    __m256i skip_lo, skip_hi;
+    widenBytes(_mm256_and_si256(skip, _mm256_set1_epi8(2)), skip_lo, skip_hi);
+    _mm256_storeu_si256(pc_lo, _mm256_add_epi16(pc[0], _mm256_add_epi16(skip_lo, _mm256_set1_epi16(2))));
+    _mm256_storeu_si256(pc_hi, _mm256_add_epi16(pc[1], _mm256_add_epi16(skip_hi, _mm256_set1_epi16(2))));
+
+    return true;
+}
+
+//Adds CHIP8_TIMER_FREQ to every machine's timer accumulator and ticks DT and ST once for every
+//time it reaches the clock rate, same as the loop at the end of Chip8::runInterpreter
+FISH_TARGET_AVX2 static void tickTimersAvx2(const BatchBlock &block, uint32_t clock_rate) {
+    const __m256i clock = _mm256_set1_epi32(clock_rate);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    __m256i accum[BATCH_BLOCK / 8];
+
+    for(uint32_t k = 0; k < BATCH_BLOCK / 8; k++) {
+        accum[k] = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.timer_accum + k * 8)), _mm256_set1_epi32(CHIP8_TIMER_FREQ));
+    }
+
+    __m256i dt = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.DT));
+    __m256i st = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.ST));
+
+    //Only clock rates below 60 Hz can tick more than once
+    for(;;) {
+        __m256i tick[BATCH_BLOCK / 8];
+        for(uint32_t k = 0; k < BATCH_BLOCK / 8; k++) {
+            tick[k] = _mm256_cmpeq_epi32(_mm256_max_epu32(accum[k], clock), accum[k]); //accum >= clock
+            accum[k] = _mm256_sub_epi32(accum[k], _mm256_and_si256(tick[k], clock));
+        }
+
+        //Narrow the 32-bit masks to one byte per machine, packing interleaves them so they are put back in order
+        __m256i ticks = _mm256_packs_epi16(_mm256_packs_epi32(tick[0], tick[1]), _mm256_packs_epi32(tick[2], tick[3]));
+        ticks = _mm256_permutevar8x32_epi32(ticks, order);
+        if(_mm256_testz_si256(ticks, ticks)) { break; }
+
+        __m256i one = _mm256_and_si256(ticks, _mm256_set1_epi8(1));
+        dt = _mm256_subs_epu8(dt, one);
+        st = _mm256_subs_epu8(st, one);
+    }
+
+    for(uint32_t k = 0; k < BATCH_BLOCK / 8; k++) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(block.timer_accum + k * 8), accum[k]);
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(block.DT), dt);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(block.ST), st);
+}
+
+#endif
+
+BatchCore::BatchCore(uint32_t size) {
+    m_size = size;
+    m_lanes = (size + BATCH_BLOCK - 1) / BATCH_BLOCK * BATCH_BLOCK;
+    m_clock_rate = CHIP8_DEFAULT_CLOCK;
+    m_quirks = MODERN_QUIRKS;
+    m_level = detectSimdLevel();
+
+    m_V.assign(static_cast<size_t>(m_lanes) * CHIP8_V_REG_COUNT, 0);
+    m_I.assign(m_lanes, 0);
+    m_PC.assign(m_lanes, 0);
+    m_last_pc.assign(m_lanes, 0);
+    m_SP.assign(m_lanes, 0);
+    m_DT.assign(m_lanes, 0);
+    m_ST.assign(m_lanes, 0);
+    m_RNG.assign(m_lanes, 0);
+    m_timer_accum.assign(m_lanes, 0);
+    m_cycles.assign(m_lanes, 0);
+    m_idle_cycles.assign(m_lanes, 0);
+    m_waiting.assign(m_lanes, 0);
+
+    //Gathering an instruction near the end of the last machine's memory reads a few bytes past it
+    m_mem.assign(static_cast<size_t>(m_lanes) * CHIP8_MEM_SIZE + sizeof(uint32_t), 0);
+    m_screen.assign(static_cast<size_t>(m_lanes) * CHIP8_SCREEN_HEIGHT, 0);
+    m_stack.assign(static_cast<size_t>(m_lanes) * BATCH_STACK_SIZE, 0);
+    m_keys.assign(m_lanes, {});
+
+    //Every machine starts out like a new Chip8, with the font loaded and nothing else
+    Chip8 blank;
+    MachineState state;
+    blank.saveState(state);
+
+    for(uint32_t i = 0; i < m_lanes; i++) {
+        loadState(i, state);
+    }
+}
+
+BatchCore::~BatchCore() { }
+
+uint32_t BatchCore::getSize() const {
+    return m_size;
+}
+
+void BatchCore::setClockRate(uint32_t hz) {
+    //Same as Chip8, a rate of zero would tick the timers forever
+    m_clock_rate = hz > 0 ? hz : 1;
+}
+
+uint32_t BatchCore::getClockRate() const {
+    return m_clock_rate;
+}
+
+void BatchCore::setQuirkProfile(QuirkProfile profile) {
+    m_quirks = profile;
+    m_interpreter.setQuirks(profile);
+}
+
+QuirkProfile BatchCore::getQuirkProfile() const {
+    return m_quirks;
+}
+
+void BatchCore::setSimdLevel(SimdLevel level) {
+    //Never more than the CPU has
+    m_level = std::min(level, detectSimdLevel());
+}
+
+SimdLevel BatchCore::getSimdLevel() const {
+    return m_level;
+}
+
+void BatchCore::cycle(uint32_t num, const uint16_t *keys) {
+    for(uint32_t i = 0; i < m_size; i++) {
+        for(uint32_t k = 0; k < CHIP8_NUM_KEYS; k++) {
+            m_keys[i][k] = (keys[i] >> k) & 1;
+        }
+
+        //Any key wakes up LD Vx, K, which then runs again to see which one it was
+        if(m_waiting[i]) { m_waiting[i] = keys[i] == 0; }
+    }
+
+    //Machines don't affect each other, so each block runs the whole batch before the next one
+    //starts and keeps its state in cache the whole time
+    withQuirks(m_quirks, [&](auto quirks) {
+        for(uint32_t base = 0; base < m_size; base += BATCH_BLOCK) {
+            runBlock<decltype(quirks)>(base, num);
+        }
+    });
+
+    for(uint32_t i = 0; i < m_size; i++) {
+        m_cycles[i] += num;
+    }
+}
+
+template<typename Q>
+void BatchCore::runBlock(uint32_t base, uint32_t num) {
+    const uint32_t count = std::min(BATCH_BLOCK, m_size - base);
+
+    BatchBlock block;
+    block.V = &m_V[base];
+    block.stride = m_lanes;
+    block.I = &m_I[base];
+    block.PC = &m_PC[base];
+    block.last_pc = &m_last_pc[base];
+    block.DT = &m_DT[base];
+    block.ST = &m_ST[base];
+    block.timer_accum = &m_timer_accum[base];
+    block.waiting = &m_waiting[base];
+    block.mem = &m_mem[static_cast<size_t>(base) * CHIP8_MEM_SIZE];
+    block.count = count;
+
+    uint32_t step = 0;
+    uint32_t diverged_steps = DIVERGED_STEPS;
+
+    while(step < num) {
+        bool uniform = false;
+
+#if FISH_SIMD_X64
+        uint16_t instr;
+        if(m_level >= SIMD_AVX2 && fetchUniformAvx2(block, instr)) {
+            m_interpreter.decode(instr);
+
+            if(stepUniformAvx2<Q>(block, m_interpreter.m_opcode, m_interpreter.m_operands)) {
+                tickTimersAvx2(block, m_clock_rate);
+                diverged_steps = DIVERGED_STEPS;
+                step++;
+                continue;
+            }
+
+            uniform = true;
+        }
+#endif
+
+        //The instruction is the same everywhere but needs more than the machines' registers, so
+        //each one runs just that instruction and they stay together. Machines that have diverged
+        //run a few steps on their own, so their memory stays in cache, and back off further each
+        //time they still haven't come back together. Without AVX2 they never are tried together,
+        //so each one runs the rest of the batch.
+        uint32_t steps = num - step;
+        if(m_level >= SIMD_AVX2) {
+            steps = uniform ? 1 : std::min(diverged_steps, steps);
+            diverged_steps = uniform ? DIVERGED_STEPS : std::min(diverged_steps * 2, MAX_DIVERGED_STEPS);
+        }
+
+        for(uint32_t lane = base; lane < base + count; lane++) {
+            runLane(lane, steps);
+        }
+
+        step += steps;
+    }
+}
+
+void BatchCore::runLane(uint32_t lane, uint32_t num) {
+    //Same as Chip8::runInterpreter, with the machine's registers gathered into a Registers for
+    //the instruction functions and put back once it is done
+    uint8_t *const V = &m_V[lane];
+    const uint32_t stride = m_lanes;
+
+    Registers regs;
+    for(uint32_t r = 0; r < CHIP8_V_REG_COUNT; r++) {
+        regs.V[r] = V[r * stride];
+    }
+
+    regs.I = m_I[lane];
+    regs.PC = m_PC[lane];
+    regs.SP = m_SP[lane];
+    regs.DT = m_DT[lane];
+    regs.ST = m_ST[lane];
+    regs.RNG = m_RNG[lane];
+
+    uint16_t last_pc = m_last_pc[lane];
+    uint32_t timer_accum = m_timer_accum[lane];
+    bool waiting = m_waiting[lane] != 0;
+    uint32_t idle = 0;
+
+    uint8_t *const mem = &m_mem[static_cast<size_t>(lane) * CHIP8_MEM_SIZE];
+    uint64_t *const screen = &m_screen[static_cast<size_t>(lane) * CHIP8_SCREEN_HEIGHT];
+    uint16_t *const stack = &m_stack[static_cast<size_t>(lane) * BATCH_STACK_SIZE];
+    const bool *const keys = m_keys[lane].data();
+    const uint32_t clock_rate = m_clock_rate;
+
+    for(uint32_t i = 0; i < num; i++) {
+        if(waiting) {
+            idle++;
+        } else {
+            regs.PC &= CHIP8_MEM_SIZE - 1;
+            last_pc = regs.PC;
+
+            m_interpreter.decode((mem[regs.PC] << 8) | mem[(regs.PC + 1) & (CHIP8_MEM_SIZE - 1)]);
+            m_interpreter.execute(regs, mem, screen, stack, keys);
+            regs.PC += 2;
+
+            //LD Vx, K moves PC back onto itself when no key is down
+            waiting = m_interpreter.m_opcode == OP_LD_F0A && regs.PC == last_pc;
+        }
+
+        //Tick the timers at 60 Hz in emulated time
+        timer_accum += CHIP8_TIMER_FREQ;
+        while(timer_accum >= clock_rate) {
+            timer_accum -= clock_rate;
+            regs.DT -= regs.DT > 0 ? 1 : 0;
+            regs.ST -= regs.ST > 0 ? 1 : 0;
+        }
+    }
+
+    for(uint32_t r = 0; r < CHIP8_V_REG_COUNT; r++) {
+        V[r * stride] = regs.V[r];
+    }
+
+    m_I[lane] = regs.I;
+    m_PC[lane] = regs.PC;
+    m_SP[lane] = regs.SP;
+    m_DT[lane] = regs.DT;
+    m_ST[lane] = regs.ST;
+    m_RNG[lane] = regs.RNG;
+    m_last_pc[lane] = last_pc;
+    m_timer_accum[lane] = timer_accum;
+    m_waiting[lane] = waiting;
+    m_idle_cycles[lane] += idle;
+}
+
+void BatchCore::saveState(uint32_t index, MachineState &state) const {
+    for(uint32_t r = 0; r < CHIP8_V_REG_COUNT; r++) {
+        state.regs.V[r] = m_V[r * m_lanes + index];
+    }
+
+    state.regs.I = m_I[index];
+    state.regs.PC = m_PC[index];
+    state.regs.SP = m_SP[index];
+    state.regs.DT = m_DT[index];
+    state.regs.ST = m_ST[index];
+    state.regs.RNG = m_RNG[index];
+    state.last_pc = m_last_pc[index];
+
+    memcpy(state.stack, &m_stack[static_cast<size_t>(index) * BATCH_STACK_SIZE], sizeof(state.stack));
+    memcpy(state.mem, &m_mem[static_cast<size_t>(index) * CHIP8_MEM_SIZE], sizeof(state.mem));
+    memcpy(state.screen, &m_screen[static_cast<size_t>(index) * CHIP8_SCREEN_HEIGHT], sizeof(state.screen));
+
+    state.cycles = m_cycles[index];
+    state.idle_cycles = m_idle_cycles[index];
+    state.timer_accum = m_timer_accum[index];
+    state.waiting_for_key = m_waiting[index] != 0;
+}
+
+void BatchCore::loadState(uint32_t index, const MachineState &state) {
+    for(uint32_t r = 0; r < CHIP8_V_REG_COUNT; r++) {
+        m_V[r * m_lanes + index] = state.regs.V[r];
+    }
+
+    m_I[index] = state.regs.I;
+    m_PC[index] = state.regs.PC;
+    m_SP[index] = state.regs.SP;
+    m_DT[index] = state.regs.DT;
+    m_ST[index] = state.regs.ST;
+    m_RNG[index] = state.regs.RNG;
+    m_last_pc[index] = state.last_pc;
+
+    //Entries past the saved ones are only reachable after an overflow, clear them so that doesn't depend on the lane's history
+    uint16_t *stack = &m_stack[static_cast<size_t>(index) * BATCH_STACK_SIZE];
+    memcpy(stack, state.stack, sizeof(state.stack));
+    memset(stack + CHIP8_STACK_MAX, 0, (BATCH_STACK_SIZE - CHIP8_STACK_MAX) * sizeof(uint16_t));
+    memcpy(&m_mem[static_cast<size_t>(index) * CHIP8_MEM_SIZE], state.mem, sizeof(state.mem));
+    memcpy(&m_screen[static_cast<size_t>(index) * CHIP8_SCREEN_HEIGHT], state.screen, sizeof(state.screen));
+
+    m_cycles[index] = state.cycles;
+    m_idle_cycles[index] = state.idle_cycles;
+    m_timer_accum[index] = state.timer_accum;
+    m_waiting[index] = state.waiting_for_key;
+}
+
+uint64_t BatchCore::getCycleCount(uint32_t index) const {
+    return m_cycles[index];
+}
+
+uint64_t BatchCore::getIdleCycleCount(uint32_t index) const {
+    return m_idle_cycles[index];
+}
+
+bool BatchCore::isWaitingForKey(uint32_t index) const {
+    return m_waiting[index] != 0;
+}
+
+uint8_t BatchCore::readMemory(uint32_t index, uint16_t address) const {
+    return m_mem[static_cast<size_t>(index) * CHIP8_MEM_SIZE + wrapAddress(address)];
+}
+
+const uint64_t* BatchCore::getScreenRows(uint32_t index) const {
+    return &m_screen[static_cast<size_t>(index) * CHIP8_SCREEN_HEIGHT];
+}
+
+}
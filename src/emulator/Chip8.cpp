@@ -1,11 +1,18 @@
 #include "Chip8.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <vector>
 
 #include "Log.hpp"
+#include "Quirks.hpp"
+#include "Rewind.hpp"
+#include "SaveState.hpp"
 
 namespace fish {
 
@@ -29,6 +36,17 @@ const uint8_t FONT_DATA[80] = {
 };
 
 Chip8::Chip8() {
+    m_clock_rate = CHIP8_DEFAULT_CLOCK;
+    m_timer_mode = CYCLE_TIMERS;
+    m_timer_step = CHIP8_TIMER_FREQ;
+    m_core = INTERPRETER_CORE;
+    m_quirks = MODERN_QUIRKS;
+    m_run_threaded = &Chip8::runThreaded<ModernQuirks>;
+    m_clip_sprites = ModernQuirks::clip;
+    m_skip_idle = true;
+    m_seed = CHIP8_DEFAULT_SEED;
+    m_deterministic = false;
+    m_last_time = 0;
     init();
 }
 
@@ -48,16 +66,35 @@ void Chip8::init() {
     m_regs.SP = 0;
     m_regs.ST = 0;
     m_regs.DT = 0;
+    m_regs.RNG = seedRandom(m_seed);
     m_last_pc = 0x200;
 
     //Clear stack
     memset(m_stack, 0, CHIP8_STACK_MAX * sizeof(uint16_t));
 
-    //Clear screen buffer
-    memset(m_screen, 0, CHIP8_SCREEN_PIXELS);
+    //Clear screen buffer, everything has to be redrawn
+    memset(m_screen, 0, sizeof(m_screen));
+    m_dirty_rows = ~0u;
+    m_written_pages = CHIP8_ALL_PAGES;
+
+    //Memory was replaced so nothing decoded is valid anymore
+    m_interpreter.invalidateAll();
+    m_jit.invalidateAll();
+
+    //Reset timing, the clock rate and timer mode are settings so they are kept
+    m_cycles = 0;
+    m_idle_cycles = 0;
+    m_waiting_for_key = false;
+    m_timer_accum = 0;
+    m_realtime_accum = 0;
 
     //Clear Current ROM Info
     m_current_rom  = {};
+
+    //History of another ROM can't be rewound into
+    if(m_rewind) {
+        m_rewind->clear();
+    }
 }
 
 StatusCode Chip8::loadRom(const std::string &path) {
@@ -83,59 +120,588 @@ StatusCode Chip8::loadRom(const std::string &path) {
         return FILE_NOT_GOOD;
     }
 
-    //Reset memory
-    init();
+    //Read in the goods
+    std::vector<uint8_t> rom(size);
+    fstream.read((char*)rom.data(), size);
+
+    loadRom(rom.data(), size, file_name(base_name(path)));
 
-    //Fill in rom data for the current loaded ROM
-    m_current_rom.size = size;
     m_current_rom.path = path;
-    m_current_rom.name = file_name(base_name(path));
     m_current_rom.ext  = path.substr(path.find_last_of('.'));
 
-    //Load rom into a byte array
-    uint8_t *rom = new uint8_t[size];
+    return OK;
+}
 
-    //Read in the goods
-    fstream.read((char*)rom, size);
+StatusCode Chip8::loadRom(const uint8_t *data, size_t size, const std::string &name) {
+    if(size > CHIP8_ROM_MAX || size == 0) {
+        LOG_WARN("[EMU]: ROM %s is an invalid size, < 0 or > 0x%X", name, CHIP8_ROM_MAX);
+        return INVALID_FILE_SIZE;
+    }
+
+    //Reset memory
+    init();
+
+    //Fill in rom data for the current loaded ROM, a buffer has no path or extension
+    m_current_rom = RomInfo();
+    m_current_rom.size = size;
+    m_current_rom.name = name;
 
     //Load ROM into memory, after the reserved space going up to 0x01ff
-    memcpy(&m_mem[0x200], rom, size);
+    memcpy(&m_mem[0x200], data, size);
 
-    //Delete array
-    delete[] rom;
+    m_current_rom.hash = 0xcbf29ce484222325;
+    for(size_t i = 0; i < size; i++) {
+        m_current_rom.hash ^= data[i];
+        m_current_rom.hash *= 0x100000001b3;
+    }
 
     return OK;
 }
 
+static bool anyKeyDown(const bool *keys) {
+    for(uint32_t i = 0; i < CHIP8_NUM_KEYS; i++) {
+        if(keys[i]) { return true; }
+    }
+
+    return false;
+}
+
 void Chip8::cycle(uint32_t num, const bool keys[CHIP8_NUM_KEYS], bool freeze_timers) {
-    for(uint32_t i = 0; i < num; i++) {    
-        //Update Timers by the time passed whenever the emulator was last updated
-        long long this_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-        if(!freeze_timers) {
-            m_regs.DT = (this_time - m_last_time) * 0.06 < m_regs.DT ? static_cast<uint8_t>(m_regs.DT - (this_time - m_last_time) * 0.06) : 0;
-            m_regs.ST = (this_time - m_last_time) * 0.06 < m_regs.ST ? static_cast<uint8_t>(m_regs.ST - (this_time - m_last_time) * 0.06) : 0;
+    //In realtime mode the clock is only read once per call instead of once per instruction
+    if(m_timer_mode == REALTIME_TIMERS) {
+        updateRealtimeTimers(freeze_timers);
+    }
+
+    //Any key wakes up LD Vx, K, which then runs again to see which one it was
+    if(m_waiting_for_key) {
+        m_waiting_for_key = !anyKeyDown(keys);
+    }
+
+    uint32_t executed = 0;
+
+    if(!m_waiting_for_key) {
+        switch(m_core) {
+            case THREADED_CORE : executed = (this->*m_run_threaded)(num, keys); break;
+            case JIT_CORE : executed = runJit(num, keys); break;
+            default : executed = runInterpreter(num, keys); break;
         }
-        m_last_time = this_time;
+    }
 
+    //The rest of the batch is spent waiting for a key, the keys can't change until the next
+    //call so only the timers have to be brought up to date
+    advanceTimers(num - executed);
+    m_idle_cycles += num - executed;
+    m_cycles += num;
+}
+
+uint32_t Chip8::runInterpreter(uint32_t num, const bool *keys) {
+    for(uint32_t i = 0; i < num; i++) {
+        m_regs.PC &= CHIP8_MEM_SIZE - 1;
         m_last_pc = m_regs.PC;
-        uint16_t instruction = (m_mem[m_regs.PC] << 8) | m_mem[m_regs.PC + 1];
-        m_interpreter.decode(instruction);
-        m_interpreter.execute(m_regs, m_mem, m_screen, m_stack, keys);
+
+        //Copied, since the instruction could overwrite its own cache entry
+        DecodedInstruction instr = m_interpreter.fetch(m_mem, m_regs.PC);
+        uint16_t store_addr = m_regs.I;
+
+        //Remember which rows change, Vy has to be read before DRW can overwrite it with VF
+        if(instr.opcode == OP_DRW) {
+            m_dirty_rows |= spriteRows(m_regs.V[instr.y], instr.n, m_clip_sprites);
+        } else if(instr.opcode == OP_CLS) {
+            m_dirty_rows = ~0u;
+        }
+
+        m_interpreter.execute(instr, m_regs, m_mem, m_screen, m_stack, keys);
         m_regs.PC += 2; //Instructions are 2 bytes long
+
+        //Throw away decoded instructions that were just overwritten
+        if(instr.opcode == OP_LD_F33) { invalidateCode(store_addr, 3); }
+        else if(instr.opcode == OP_LD_F55) { invalidateCode(store_addr, instr.x + 1); }
+
+        //Tick the timers at 60 Hz in emulated time, m_timer_step is 0 in realtime mode
+        m_timer_accum += m_timer_step;
+        while(m_timer_accum >= m_clock_rate) {
+            m_timer_accum -= m_clock_rate;
+            tickTimers();
+        }
+
+        //LD Vx, K moves PC back onto itself when no key is down
+        if(instr.opcode == OP_LD_F0A && m_regs.PC == m_last_pc) {
+            m_waiting_for_key = true;
+            return i + 1;
+        }
+
+        //Jumping backwards could have landed at the start of a loop that only waits
+        if(m_regs.PC <= m_last_pc && i + 1 < num) {
+            i += skipIdleLoop(num - i - 1, keys);
+        }
+    }
+
+    return num;
+}
+
+uint32_t Chip8::runJit(uint32_t num, const bool *keys) {
+    uint32_t remaining = num;
+
+    while(remaining > 0) {
+        m_regs.PC &= CHIP8_MEM_SIZE - 1;
+        const Block *block = m_jit.lookup(m_interpreter, m_mem, m_regs.PC);
+
+        //Blocks never read or write the timers, so ticking them afterwards for the whole
+        //block gives the same result as ticking them after every instruction
+        if(block != nullptr && block->length <= remaining) {
+            m_last_pc = m_regs.PC + (block->length - 1) * 2;
+            block->code(&m_regs, keys, m_mem);
+            advanceTimers(block->length);
+            remaining -= block->length;
+        } else {
+            runInterpreter(1, keys);
+            remaining--;
+
+            if(m_waiting_for_key) { break; }
+        }
+
+        if(m_regs.PC <= m_last_pc && remaining > 0) {
+            remaining -= skipIdleLoop(remaining, keys);
+        }
     }
+
+    return num - remaining;
+}
+
+void Chip8::advanceTimers(uint64_t cycles) {
+    //Same as ticking after every instruction, m_timer_step is 0 in realtime mode
+    uint64_t accum = m_timer_accum + cycles * m_timer_step;
+    uint64_t ticks = accum / m_clock_rate;
+    m_timer_accum = static_cast<uint32_t>(accum % m_clock_rate);
+
+    m_regs.DT = ticks < m_regs.DT ? static_cast<uint8_t>(m_regs.DT - ticks) : 0;
+    m_regs.ST = ticks < m_regs.ST ? static_cast<uint8_t>(m_regs.ST - ticks) : 0;
+}
+
+//Recognizes loops at PC that can't change anything but the timers until the delay timer
+//runs out or a key changes, and runs as many whole iterations of them as fit in remaining
+//instantly. Keys only change between calls to cycle(), so a loop polling them spins for
+//the rest of the batch. Returns the number of cycles skipped, always whole iterations,
+//with the machine left exactly as if they had been executed.
+uint32_t Chip8::skipIdleLoop(uint32_t remaining, const bool *keys) {
+    uint16_t pc = m_regs.PC & (CHIP8_MEM_SIZE - 1);
+
+    if(!m_skip_idle || pc > CHIP8_MEM_SIZE - 6) {
+        return 0;
+    }
+
+    const DecodedInstruction &head = m_interpreter.fetch(m_mem, pc);
+    uint32_t length = 0;
+    uint32_t iterations = 0;
+
+    switch(head.opcode) {
+        //JP to itself
+        case OP_JP_1 :
+            if(head.nnn != pc) { return 0; }
+
+            length = 1;
+            iterations = remaining;
+        break;
+
+        //SKP Vx or SKNP Vx, then JP back, while the key is up or down
+        case OP_SKP :
+        case OP_SKNP : {
+            const DecodedInstruction &jump = m_interpreter.fetch(m_mem, pc + 2);
+            uint8_t key = m_regs.V[head.x] & (CHIP8_NUM_KEYS - 1);
+
+            if(jump.opcode != OP_JP_1 || jump.nnn != pc) { return 0; }
+            if(keys[key] != (head.opcode == OP_SKNP)) { return 0; }
+
+            length = 2;
+            iterations = remaining / length;
+        break;
+        }
+
+        //LD Vx, DT then SE Vx, 0 then JP back, while the delay timer is running
+        case OP_LD_F07 : {
+            const DecodedInstruction &skip = m_interpreter.fetch(m_mem, pc + 2);
+            const DecodedInstruction &jump = m_interpreter.fetch(m_mem, pc + 4);
+
+            if(skip.opcode != OP_SE_3 || skip.x != head.x || skip.nn != 0) { return 0; }
+            if(jump.opcode != OP_JP_1 || jump.nnn != pc) { return 0; }
+
+            length = 3;
+            iterations = remaining / length;
+
+            //The loop leaves on the first iteration that reads DT as 0, which is when the
+            //cycles since now have ticked the timer DT times
+            if(m_timer_step > 0) {
+                uint64_t accum_needed = static_cast<uint64_t>(m_regs.DT) * m_clock_rate - m_timer_accum;
+                uint64_t cycles_per_iteration = static_cast<uint64_t>(length) * m_timer_step;
+                uint64_t until_zero = m_regs.DT > 0 ? (accum_needed + cycles_per_iteration - 1) / cycles_per_iteration : 0;
+
+                iterations = static_cast<uint32_t>(std::min<uint64_t>(iterations, until_zero));
+            } else if(m_regs.DT == 0) {
+                iterations = 0;
+            }
+
+            if(iterations == 0) { return 0; }
+
+            //Vx holds what the last skipped iteration read
+            advanceTimers(static_cast<uint64_t>(iterations - 1) * length);
+            m_regs.V[head.x] = m_regs.DT;
+            advanceTimers(length);
+            m_last_pc = pc + 4;
+            m_regs.PC = pc;
+            m_idle_cycles += iterations * length;
+
+            return iterations * length;
+        }
+
+        default :
+            return 0;
+    }
+
+    if(iterations == 0) { return 0; }
+
+    advanceTimers(static_cast<uint64_t>(iterations) * length);
+    m_last_pc = pc + (length - 1) * 2;
+    m_regs.PC = pc;
+    m_idle_cycles += iterations * length;
+
+    return iterations * length;
+}
+
+void Chip8::invalidateCode(uint16_t address, uint16_t length) {
+    //Stores wrap around the end of memory, so the written range can be in two pieces
+    address = wrapAddress(address);
+    uint16_t first = static_cast<uint16_t>(std::min<uint32_t>(length, CHIP8_MEM_SIZE - address));
+
+    m_interpreter.invalidate(address, first);
+    m_jit.invalidate(address, first);
+
+    if(length > 0) {
+        m_written_pages |= (1u << (address / CHIP8_PAGE_SIZE)) | (1u << (wrapAddress(address + length - 1) / CHIP8_PAGE_SIZE));
+    }
+
+    if(first < length) {
+        m_interpreter.invalidate(0, length - first);
+        m_jit.invalidate(0, length - first);
+    }
+}
+
+void Chip8::tickTimers() {
+    m_regs.DT -= m_regs.DT > 0 ? 1 : 0;
+    m_regs.ST -= m_regs.ST > 0 ? 1 : 0;
+}
+
+void Chip8::updateRealtimeTimers(bool freeze_timers) {
+    //Update Timers by the time passed whenever the emulator was last updated
+    long long this_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    if(!freeze_timers) {
+        //Keep the remainder around so partial ticks aren't lost between calls
+        m_realtime_accum += (this_time - m_last_time) * CHIP8_TIMER_FREQ;
+        long long ticks = m_realtime_accum / 1000000;
+        m_realtime_accum -= ticks * 1000000;
+
+        m_regs.DT = ticks < m_regs.DT ? static_cast<uint8_t>(m_regs.DT - ticks) : 0;
+        m_regs.ST = ticks < m_regs.ST ? static_cast<uint8_t>(m_regs.ST - ticks) : 0;
+    }
+
+    m_last_time = this_time;
+}
+
+void Chip8::setClockRate(uint32_t hz) {
+    //A rate of zero would make every instruction tick the timers forever
+    m_clock_rate = hz > 0 ? hz : 1;
+}
+
+uint32_t Chip8::getClockRate() const {
+    return m_clock_rate;
+}
+
+void Chip8::setTimerMode(TimerMode mode) {
+    if(m_deterministic) {
+        mode = CYCLE_TIMERS;
+    }
+
+    if(mode == REALTIME_TIMERS && m_timer_mode != REALTIME_TIMERS) {
+        //Start counting from now rather than from whenever realtime mode was last used
+        m_last_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        m_realtime_accum = 0;
+    }
+
+    m_timer_mode = mode;
+    m_timer_step = mode == CYCLE_TIMERS ? CHIP8_TIMER_FREQ : 0;
+}
+
+TimerMode Chip8::getTimerMode() const {
+    return m_timer_mode;
+}
+
+void Chip8::setRandomSeed(uint64_t seed) {
+    m_seed = seed;
+    m_regs.RNG = seedRandom(seed);
+}
+
+uint64_t Chip8::getRandomSeed() const {
+    return m_seed;
+}
+
+void Chip8::setDeterministic(bool enabled) {
+    m_deterministic = enabled;
+
+    if(enabled) {
+        setTimerMode(CYCLE_TIMERS);
+    }
+}
+
+bool Chip8::isDeterministic() const {
+    return m_deterministic;
+}
+
+uint64_t Chip8::getCycleCount() const {
+    return m_cycles;
+}
+
+uint64_t Chip8::getIdleCycleCount() const {
+    return m_idle_cycles;
+}
+
+uint32_t Chip8::getCyclesToTimerTick() const {
+    if(m_timer_step == 0) {
+        return 0;
+    }
+
+    //Lowering the clock rate can leave the accumulator past it until the next instruction
+    if(m_timer_accum >= m_clock_rate) {
+        return 1;
+    }
+
+    return (m_clock_rate - m_timer_accum + m_timer_step - 1) / m_timer_step;
+}
+
+void Chip8::setIdleSkipping(bool enabled) {
+    m_skip_idle = enabled;
+}
+
+bool Chip8::isWaitingForKey() const {
+    return m_waiting_for_key;
+}
+
+void Chip8::setCore(CoreType core) {
+    m_core = core;
+}
+
+CoreType Chip8::getCore() const {
+    return m_core;
+}
+
+void Chip8::setQuirkProfile(QuirkProfile profile) {
+    if(profile == m_quirks) {
+        return;
+    }
+
+    //Each core has its own version for every profile, swap them all over
+    m_quirks = profile;
+    m_interpreter.setQuirks(profile);
+    m_jit.setQuirks(profile);
+    m_run_threaded = withQuirks(profile, [](auto quirks) { return &Chip8::runThreaded<decltype(quirks)>; });
+    m_clip_sprites = withQuirks(profile, [](auto quirks) { return decltype(quirks)::clip; });
+}
+
+QuirkProfile Chip8::getQuirkProfile() const {
+    return m_quirks;
 }
 
 uint8_t Chip8::getScreenPixel(uint8_t x, uint8_t y) const {
-    return m_screen[x + y * CHIP8_SCREEN_WIDTH];
+    return screenPixel(m_screen, x, y);
+}
+
+uint64_t Chip8::getScreenRow(uint8_t y) const {
+    return m_screen[y];
+}
+
+const uint64_t* Chip8::getScreenRows() const {
+    return m_screen;
+}
+
+void Chip8::expandScreen(uint8_t pixels[CHIP8_SCREEN_PIXELS]) const {
+    for(uint32_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        uint64_t row = m_screen[y];
+
+        for(uint32_t x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
+            pixels[x + y * CHIP8_SCREEN_WIDTH] = (row >> (CHIP8_SCREEN_WIDTH - 1 - x)) & 1;
+        }
+    }
 }
 
-bool Chip8::shouldPlaySound() {
+uint64_t Chip8::getScreenHash() const {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    //Hash the rows a byte at a time from the left, so the result doesn't depend on endianness
+    for(uint32_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        for(int32_t shift = CHIP8_SCREEN_WIDTH - 8; shift >= 0; shift -= 8) {
+            hash ^= (m_screen[y] >> shift) & 0xff;
+            hash *= 0x100000001b3;
+        }
+    }
+
+    return hash;
+}
+
+uint32_t Chip8::getDirtyRows() const {
+    return m_dirty_rows;
+}
+
+uint32_t Chip8::consumeDirtyRows() {
+    uint32_t rows = m_dirty_rows;
+    m_dirty_rows = 0;
+    return rows;
+}
+
+uint32_t Chip8::consumeWrittenPages() {
+    uint32_t pages = m_written_pages;
+    m_written_pages = 0;
+    return pages;
+}
+
+bool Chip8::shouldPlaySound() const {
     return m_regs.ST > 0;
 }
 
 bool Chip8::detectLoop() {
-    //Check if the current instruction is just jumping to itself
-    return (m_interpreter.m_opcode == 3) && (m_interpreter.m_operands == m_last_pc);
+    //Check if the last instruction is just jumping to itself
+    const DecodedInstruction &instr = m_interpreter.fetch(m_mem, m_last_pc);
+    return (instr.opcode == OP_JP_1) && (instr.nnn == m_last_pc);
+}
+
+void Chip8::saveState(MachineState &state, uint32_t pages) const {
+    state.regs = m_regs;
+    state.last_pc = m_last_pc;
+    memcpy(state.stack, m_stack, sizeof(m_stack));
+    memcpy(state.screen, m_screen, sizeof(m_screen));
+    state.cycles = m_cycles;
+    state.idle_cycles = m_idle_cycles;
+    state.timer_accum = m_timer_accum;
+    state.waiting_for_key = m_waiting_for_key;
+
+    if(pages == CHIP8_ALL_PAGES) {
+        memcpy(state.mem, m_mem, sizeof(m_mem));
+        return;
+    }
+
+    for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+        if(pages & (1u << page)) { memcpy(&state.mem[page * CHIP8_PAGE_SIZE], &m_mem[page * CHIP8_PAGE_SIZE], CHIP8_PAGE_SIZE); }
+    }
+}
+
+void Chip8::loadState(const MachineState &state, uint32_t pages) {
+    //Only throw away decoded instructions where memory actually changes, states saved close
+    //together (rewind, run-ahead) usually share almost all of it
+    static constexpr uint32_t CHUNK = 64;
+
+    for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+        if(!(pages & (1u << page))) { continue; }
+
+        for(uint32_t address = page * CHIP8_PAGE_SIZE; address < (page + 1) * CHIP8_PAGE_SIZE; address += CHUNK) {
+            if(memcmp(&m_mem[address], &state.mem[address], CHUNK) != 0) {
+                invalidateCode(static_cast<uint16_t>(address), CHUNK);
+                memcpy(&m_mem[address], &state.mem[address], CHUNK);
+            }
+        }
+    }
+
+    m_regs = state.regs;
+    m_last_pc = state.last_pc;
+    memcpy(m_stack, state.stack, sizeof(m_stack));
+    memcpy(m_screen, state.screen, sizeof(m_screen));
+    m_cycles = state.cycles;
+    m_idle_cycles = state.idle_cycles;
+    m_timer_accum = state.timer_accum;
+    m_waiting_for_key = state.waiting_for_key;
+
+    m_dirty_rows = ~0u;
+}
+
+StatusCode Chip8::saveStateFile(const std::string &path) const {
+    MachineState state;
+    saveState(state);
+    std::vector<uint8_t> data = serializeState(state);
+
+    std::ofstream fstream(path, std::ios::binary);
+    fstream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    if(!fstream.good()) {
+        LOG_WARN("[EMU]: Could not write save state %s", base_name(path));
+        return FILE_NOT_GOOD;
+    }
+
+    return OK;
+}
+
+StatusCode Chip8::loadStateFile(const std::string &path) {
+    if(!std::filesystem::exists(path)) {
+        LOG_WARN("[EMU]: Save state %s was not found", base_name(path));
+        return FILE_NOT_FOUND;
+    }
+
+    std::ifstream fstream(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(fstream)), std::istreambuf_iterator<char>());
+
+    if(fstream.bad()) {
+        LOG_WARN("[EMU]: Save state %s could not be loaded because filestream is not good", base_name(path));
+        return FILE_NOT_GOOD;
+    }
+
+    MachineState state;
+    StatusCode status = deserializeState(data.data(), data.size(), state);
+
+    if(status == OK) {
+        loadState(state);
+    }
+
+    return status;
+}
+
+void Chip8::setRewindLength(uint32_t frames, uint32_t keyframe_interval) {
+    if(frames == 0) {
+        m_rewind.reset();
+        return;
+    }
+
+    if(!m_rewind) {
+        m_rewind = std::make_unique<RewindBuffer>();
+    }
+
+    m_rewind->setCapacity(frames, keyframe_interval);
+}
+
+void Chip8::recordRewindFrame() {
+    if(!m_rewind) {
+        return;
+    }
+
+    //Zeroed so the padding between fields never shows up as a difference
+    MachineState state;
+    memset(&state, 0, sizeof(state));
+    saveState(state);
+    m_rewind->push(state);
+}
+
+bool Chip8::rewindFrame() {
+    MachineState state;
+
+    if(!m_rewind || !m_rewind->pop(state)) {
+        return false;
+    }
+
+    loadState(state);
+    return true;
+}
+
+uint32_t Chip8::getRewindFrameCount() const {
+    return m_rewind ? m_rewind->getFrameCount() : 0;
+}
+
+size_t Chip8::getRewindByteCount() const {
+    return m_rewind ? m_rewind->getByteCount() : 0;
 }
 
 RomInfo Chip8::getRomInfo() const {
@@ -1,5 +1,7 @@
 #include "Debugger.hpp"
 
+#include <cstring>
+
 #include <fmt/printf.h>
 
 namespace fish {
@@ -41,50 +43,59 @@ bool Debugger::hasInstance() const {
 }
 
 
-uint8_t* Debugger::getMemory() {
-    return m_instance->m_mem;
+void Debugger::capture(DebugSnapshot &snapshot) {
+    snapshot.regs = m_instance->m_regs;
+    snapshot.last_pc = m_instance->m_last_pc;
+    memcpy(snapshot.stack, m_instance->m_stack, sizeof(snapshot.stack));
+    memcpy(snapshot.mem, m_instance->m_mem, sizeof(snapshot.mem));
+    memcpy(snapshot.screen, m_instance->m_screen, sizeof(snapshot.screen));
+    snapshot.cycles = m_instance->m_cycles;
+    snapshot.waiting_for_key = m_instance->m_waiting_for_key;
+    snapshot.play_sound = m_instance->shouldPlaySound();
 }
 
-uint16_t* Debugger::getStack() {
-    return m_instance->m_stack;
-}
 
-uint8_t* Debugger::getScreen() {
-    return m_instance->m_screen;
+void Debugger::setVRegister(size_t index, uint8_t value) {
+    m_instance->m_regs.V[index] = value;
 }
 
-
-uint8_t* Debugger::getVRegister(size_t index) {
-    return &m_instance->m_regs.V[index];
+void Debugger::setStackPointer(uint8_t value) {
+    m_instance->m_regs.SP = value;
 }
 
-uint8_t* Debugger::getStackPointer() {
-    return &m_instance->m_regs.SP;
+void Debugger::setStackEntry(size_t index, uint16_t value) {
+    m_instance->m_stack[index] = value;
 }
 
-uint16_t* Debugger::getIRegister() {
-    return &m_instance->m_regs.I;
+void Debugger::setIRegister(uint16_t value) {
+    m_instance->m_regs.I = value;
 }
 
-uint16_t* Debugger::getProgramCounter() {
-    return &m_instance->m_regs.PC;
+void Debugger::setProgramCounter(uint16_t value) {
+    m_instance->m_regs.PC = value;
 }
 
-uint8_t* Debugger::getDelayTimer() {
-    return &m_instance->m_regs.DT;
+void Debugger::setDelayTimer(uint8_t value) {
+    m_instance->m_regs.DT = value;
 }
 
-uint8_t* Debugger::getSoundTimer() {
-    return &m_instance->m_regs.ST;
+void Debugger::setSoundTimer(uint8_t value) {
+    m_instance->m_regs.ST = value;
 }
 
-uint16_t Debugger::getInstructionAt(uint16_t address) {
-    uint8_t high = m_instance->m_mem[address];
-    uint8_t low = m_instance->m_mem[address + 1];
+uint16_t Debugger::getInstructionAt(const DebugSnapshot &snapshot, uint16_t address) {
+    uint8_t high = snapshot.mem[wrapAddress(address)];
+    uint8_t low = snapshot.mem[wrapAddress(address + 1)];
 
     return (high << 8) | low;
 }
 
+void Debugger::writeMemory(uint16_t address, uint8_t value) {
+    //Goes through here instead of writing memory directly so stale decoded instructions are thrown away
+    m_instance->m_mem[address] = value;
+    m_instance->invalidateCode(address, 1);
+}
+
 std::string Debugger::disassemble(uint16_t instruction) {
     m_interpreter.decode(instruction);
     uint16_t a, b, c; //Parameters
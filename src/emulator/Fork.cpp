@@ -0,0 +1,272 @@
+#include "Fork.hpp"
+
+#include <cstring>
+
+namespace fish {
+
+PageArena::PageArena() {
+    //Serial 0 is never handed out, so it can mean "no page"
+    m_next_serial = 1;
+}
+
+PageArena::~PageArena() { }
+
+uint32_t PageArena::allocate() {
+    if(m_free.empty()) {
+        uint32_t first = static_cast<uint32_t>(m_refs.size());
+        m_chunks.emplace_back(new uint8_t[CHUNK_PAGES * CHIP8_PAGE_SIZE]);
+        m_refs.resize(first + CHUNK_PAGES, 0);
+        m_serials.resize(first + CHUNK_PAGES, 0);
+
+        //Hand out the lowest indices first
+        for(uint32_t i = CHUNK_PAGES; i > 0; i--) {
+            m_free.push_back(first + i - 1);
+        }
+    }
+
+    uint32_t page = m_free.back();
+    m_free.pop_back();
+
+    m_refs[page] = 1;
+    touch(page);
+    return page;
+}
+
+void PageArena::release(uint32_t page) {
+    if(--m_refs[page] == 0) {
+        m_free.push_back(page);
+    }
+}
+
+size_t PageArena::getPageCount() const {
+    return m_refs.size() - m_free.size();
+}
+
+size_t PageArena::getByteCount() const {
+    return m_chunks.size() * CHUNK_PAGES * CHIP8_PAGE_SIZE;
+}
+
+ForkState::ForkState(const ForkState &other) {
+    *this = other;
+}
+
+ForkState::ForkState(ForkState &&other) noexcept {
+    *this = std::move(other);
+}
+
+ForkState& ForkState::operator=(const ForkState &other) {
+    if(this == &other) { return *this; }
+
+    //Take the new references first, other could share pages with this
+    if(other.m_arena != nullptr) {
+        for(uint32_t page : other.m_pages) { other.m_arena->retain(page); }
+        other.m_arena->retain(other.m_screen);
+    }
+
+    releasePages();
+
+    m_arena = other.m_arena;
+    memcpy(m_pages, other.m_pages, sizeof(m_pages));
+    m_screen = other.m_screen;
+    m_regs = other.m_regs;
+    m_last_pc = other.m_last_pc;
+    memcpy(m_stack, other.m_stack, sizeof(m_stack));
+    m_cycles = other.m_cycles;
+    m_idle_cycles = other.m_idle_cycles;
+    m_timer_accum = other.m_timer_accum;
+    m_waiting_for_key = other.m_waiting_for_key;
+
+    return *this;
+}
+
+ForkState& ForkState::operator=(ForkState &&other) noexcept {
+    if(this == &other) { return *this; }
+
+    releasePages();
+
+    m_arena = other.m_arena;
+    memcpy(m_pages, other.m_pages, sizeof(m_pages));
+    m_screen = other.m_screen;
+    m_regs = other.m_regs;
+    m_last_pc = other.m_last_pc;
+    memcpy(m_stack, other.m_stack, sizeof(m_stack));
+    m_cycles = other.m_cycles;
+    m_idle_cycles = other.m_idle_cycles;
+    m_timer_accum = other.m_timer_accum;
+    m_waiting_for_key = other.m_waiting_for_key;
+
+    //other keeps nothing, so its destructor doesn't drop the references it handed over
+    other.m_arena = nullptr;
+    return *this;
+}
+
+ForkState::~ForkState() {
+    releasePages();
+}
+
+void ForkState::releasePages() {
+    if(m_arena == nullptr) { return; }
+
+    for(uint32_t page : m_pages) { m_arena->release(page); }
+    m_arena->release(m_screen);
+    m_arena = nullptr;
+}
+
+uint8_t ForkState::readMemory(uint16_t address) const {
+    address = wrapAddress(address);
+    return m_arena->data(m_pages[address / CHIP8_PAGE_SIZE])[address % CHIP8_PAGE_SIZE];
+}
+
+const uint64_t* ForkState::getScreenRows() const {
+    return reinterpret_cast<const uint64_t*>(m_arena->data(m_screen));
+}
+
+uint64_t ForkState::getScreenHash() const {
+    const uint64_t *rows = getScreenRows();
+    uint64_t hash = 0xcbf29ce484222325;
+
+    //Hash the rows a byte at a time from the left, so the result doesn't depend on endianness
+    for(uint32_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        for(int32_t shift = CHIP8_SCREEN_WIDTH - 8; shift >= 0; shift -= 8) {
+            hash ^= (rows[y] >> shift) & 0xff;
+            hash *= 0x100000001b3;
+        }
+    }
+
+    return hash;
+}
+
+static_assert(sizeof(uint64_t) * CHIP8_SCREEN_HEIGHT == CHIP8_PAGE_SIZE, "The screen has to fill exactly one page");
+
+Searcher::Searcher() {
+    memset(&m_state, 0, sizeof(m_state));
+    memset(m_loaded, 0, sizeof(m_loaded));
+    m_emu.setDeterministic(true);
+}
+
+Searcher::~Searcher() { }
+
+uint32_t Searcher::copyPage(const uint8_t *data) {
+    uint32_t page = m_arena.allocate();
+    memcpy(m_arena.data(page), data, CHIP8_PAGE_SIZE);
+    return page;
+}
+
+ForkState Searcher::capture(const Chip8 &emu) {
+    m_emu.setClockRate(emu.getClockRate());
+    m_emu.setQuirkProfile(emu.getQuirkProfile());
+    m_emu.setCore(emu.getCore());
+
+    emu.saveState(m_state);
+
+    ForkState state;
+    state.m_arena = &m_arena;
+    for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+        state.m_pages[page] = copyPage(&m_state.mem[page * CHIP8_PAGE_SIZE]);
+    }
+    state.m_screen = copyPage(reinterpret_cast<const uint8_t*>(m_state.screen));
+
+    state.m_regs = m_state.regs;
+    state.m_last_pc = m_state.last_pc;
+    memcpy(state.m_stack, m_state.stack, sizeof(state.m_stack));
+    state.m_cycles = m_state.cycles;
+    state.m_idle_cycles = m_state.idle_cycles;
+    state.m_timer_accum = m_state.timer_accum;
+    state.m_waiting_for_key = m_state.waiting_for_key;
+
+    return state;
+}
+
+void Searcher::run(ForkState &state, uint32_t num, const bool keys[CHIP8_NUM_KEYS]) {
+    //Send only the pages that aren't in m_emu already
+    uint32_t changed = 0;
+
+    for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+        uint32_t index = state.m_pages[page];
+
+        if(m_loaded[page] != m_arena.serial(index)) {
+            memcpy(&m_state.mem[page * CHIP8_PAGE_SIZE], m_arena.data(index), CHIP8_PAGE_SIZE);
+            m_loaded[page] = m_arena.serial(index);
+            changed |= 1u << page;
+        }
+    }
+
+    memcpy(m_state.screen, m_arena.data(state.m_screen), CHIP8_PAGE_SIZE);
+    m_state.regs = state.m_regs;
+    m_state.last_pc = state.m_last_pc;
+    memcpy(m_state.stack, state.m_stack, sizeof(m_state.stack));
+    m_state.cycles = state.m_cycles;
+    m_state.idle_cycles = state.m_idle_cycles;
+    m_state.timer_accum = state.m_timer_accum;
+    m_state.waiting_for_key = state.m_waiting_for_key;
+
+    m_emu.loadState(m_state, changed);
+    m_emu.consumeWrittenPages();
+    m_emu.consumeDirtyRows();
+
+    m_emu.cycle(num, keys);
+
+    //Copy out what the run wrote to. A page only this state holds is changed in place, a shared
+    //one is replaced by a new page and left alone for the states still sharing it.
+    uint32_t written = m_emu.consumeWrittenPages();
+    m_emu.saveState(m_state, written);
+
+    for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+        if(!(written & (1u << page))) { continue; }
+
+        uint32_t &index = state.m_pages[page];
+        if(m_arena.refs(index) == 1) {
+            memcpy(m_arena.data(index), &m_state.mem[page * CHIP8_PAGE_SIZE], CHIP8_PAGE_SIZE);
+            m_arena.touch(index);
+        } else {
+            m_arena.release(index);
+            index = copyPage(&m_state.mem[page * CHIP8_PAGE_SIZE]);
+        }
+
+        m_loaded[page] = m_arena.serial(index);
+    }
+
+    //Drawing twice in the same place leaves the screen as it was, so compare before copying
+    if(m_emu.consumeDirtyRows() != 0 && memcmp(m_arena.data(state.m_screen), m_state.screen, CHIP8_PAGE_SIZE) != 0) {
+        if(m_arena.refs(state.m_screen) == 1) {
+            memcpy(m_arena.data(state.m_screen), m_state.screen, CHIP8_PAGE_SIZE);
+        } else {
+            m_arena.release(state.m_screen);
+            state.m_screen = copyPage(reinterpret_cast<const uint8_t*>(m_state.screen));
+        }
+    }
+
+    state.m_regs = m_state.regs;
+    state.m_last_pc = m_state.last_pc;
+    memcpy(state.m_stack, m_state.stack, sizeof(state.m_stack));
+    state.m_cycles = m_state.cycles;
+    state.m_idle_cycles = m_state.idle_cycles;
+    state.m_timer_accum = m_state.timer_accum;
+    state.m_waiting_for_key = m_state.waiting_for_key;
+}
+
+void Searcher::restore(const ForkState &state, Chip8 &emu) {
+    MachineState full;
+    memset(&full, 0, sizeof(full));
+
+    for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+        memcpy(&full.mem[page * CHIP8_PAGE_SIZE], m_arena.data(state.m_pages[page]), CHIP8_PAGE_SIZE);
+    }
+
+    memcpy(full.screen, m_arena.data(state.m_screen), CHIP8_PAGE_SIZE);
+    full.regs = state.m_regs;
+    full.last_pc = state.m_last_pc;
+    memcpy(full.stack, state.m_stack, sizeof(full.stack));
+    full.cycles = state.m_cycles;
+    full.idle_cycles = state.m_idle_cycles;
+    full.timer_accum = state.m_timer_accum;
+    full.waiting_for_key = state.m_waiting_for_key;
+
+    emu.loadState(full);
+}
+
+const PageArena& Searcher::getArena() const {
+    return m_arena;
+}
+
+}
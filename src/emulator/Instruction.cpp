@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <cstdio>
+#include <cstring>
 #include <bitset>
 
 namespace fish {
@@ -18,18 +19,18 @@ namespace fish {
 //This function would be the SYS Addr instruction which is ignored by modern interpreters
 //so I'm using it as a nop instruction
 //0nnn - SYS addr
-void NOP(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void NOP(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     return;
 }
 
 //00E0 - CLS
-void CLS(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void CLS(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Clear the screen to zeros
-    memset(screen, 0, CHIP8_SCREEN_WIDTH * CHIP8_SCREEN_HEIGHT);
+    memset(screen, 0, CHIP8_SCREEN_HEIGHT * sizeof(uint64_t));
 }
 
 //00EE - RET
-void RET(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void RET(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Set PC to address at the top of the stack
     regs.PC = stack[regs.SP];
 
@@ -38,13 +39,13 @@ void RET(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint
 }
 
 //1nnn - JP addr
-void JP_1(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void JP_1(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Set PC to the address in the lower 12 bits of the instruction, aka operands
     regs.PC = operands - 2;
 }
 
 //2nnn - CALL addr
-void CALL(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void CALL(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Increment the stack pointer TODO: Add some bounds check
     regs.SP += 1;
 
@@ -56,7 +57,7 @@ void CALL(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uin
 }
 
 //3xnn - SE Vx, byte
-void SE_3(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void SE_3(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Check if Vx is equal to nn and if so skip the next instruction
     uint8_t x = operands >> 8;
     uint8_t nn = operands & 0xff;
@@ -65,7 +66,7 @@ void SE_3(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uin
 }
 
 //4xnn - SNE Vx, byte
-void SNE_4(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stac, const bool *keys) {
+void SNE_4(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stac, const bool *keys) {
     //Check if Vx is not equal to nn and if so skip the next instruction
     uint8_t x = operands >> 8;
     uint8_t nn = operands & 0xff;
@@ -74,7 +75,7 @@ void SNE_4(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, ui
 }
 
 //5xy0 - SE Vx, Vy
-void SE_5(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void SE_5(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Check if Vx is equal to Vy and if so skip the next instruction
     uint8_t x = operands >> 8;
     uint8_t y = (operands >> 4) & 0xf;
@@ -83,7 +84,7 @@ void SE_5(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uin
 }
 
 //6xnn - LD Vx, byte
-void LD_6(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_6(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Put nn into register Vx
     uint8_t x = operands >> 8;
     uint8_t nn = operands & 0xff;
@@ -91,7 +92,7 @@ void LD_6(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uin
 }
 
 //7xnn - ADD Vx, byte
-void ADD_7(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void ADD_7(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Add nn to Vx and store it back in Vx
     uint8_t x = operands >> 8;
     uint8_t nn = operands & 0xff;
@@ -99,7 +100,7 @@ void ADD_7(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, ui
 }
 
 //8xy0 - LD Vx, Vy
-void LD_8(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_8(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Stores the value from Vy into Vx
     uint8_t x = operands >> 8;
     uint8_t y = (operands >> 4) & 0xf;
@@ -107,31 +108,43 @@ void LD_8(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uin
 }
 
 //8xy1 - OR Vx, Vy
-void OR(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void OR(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Performs a bitwise OR on Vx and Vy and stores the result into Vx
     uint8_t x = operands >> 8;
     uint8_t y = (operands >> 4) & 0xf;
     regs.V[x] |= regs.V[y];
+
+    //The VIP's logic operations leave VF set to 0
+    if constexpr(Q::reset_vf) { regs.VF = 0; }
 }
 
 //8xy2 - AND Vx, Vy
-void AND(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void AND(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Performs a bitwise AND on Vx and Vy and stores the result into Vx
     uint8_t x = operands >> 8;
     uint8_t y = (operands >> 4) & 0xf;
     regs.V[x] &= regs.V[y];
+
+    //The VIP's logic operations leave VF set to 0
+    if constexpr(Q::reset_vf) { regs.VF = 0; }
 }
 
 //8xy3 - XOR Vx, Vy
-void XOR(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void XOR(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Performs a bitwise XOR on Vx and Vy and stores the result into Vx
     uint8_t x = operands >> 8;
     uint8_t y = (operands >> 4) & 0xf;
     regs.V[x] ^= regs.V[y];
+
+    //The VIP's logic operations leave VF set to 0
+    if constexpr(Q::reset_vf) { regs.VF = 0; }
 }
 
 //8xy4 - ADD Vx, Vy
-void ADD_8(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void ADD_8(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Adds the value in Vx to the value in Vy and if the result if greater than a byte can store
     //(> 255), then VF is set to 1, otherwise 0.
     uint8_t x = operands >> 8;
@@ -142,7 +155,7 @@ void ADD_8(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, ui
 }
 
 //8xy5 - SUB Vx, Vy
-void SUB(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void SUB(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Subtracts the value in Vy from Vx and stores it into Vx, if Vx > Vy then VF is set to
     //1, otherwise 0.
     uint8_t x = operands >> 8;
@@ -153,17 +166,26 @@ void SUB(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint
 }
 
 //8xy6 - SHR Vx {, Vy}
-void SHR(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void SHR(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //If the least-significant bit is set to 1 then VF is set to 1, otherwise 0.
     //Then Vx is shifted to the right by one / divided by 2
     uint8_t x = operands >> 8;
-    //y is unused
-    regs.VF = regs.V[x] & 0x1;
-    regs.V[x] = regs.V[x] >> 1;
+    uint8_t y = (operands >> 4) & 0xf;
+
+    if constexpr(Q::shift_vy) {
+        //The VIP shifts Vy and puts the result in Vx
+        uint8_t value = regs.V[y];
+        regs.V[x] = value >> 1;
+        regs.VF = value & 0x1;
+    } else {
+        regs.VF = regs.V[x] & 0x1;
+        regs.V[x] = regs.V[x] >> 1;
+    }
 }
 
 //8xy7 - SUBN Vx, Vy
-void SUBN(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void SUBN(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Subtracts the value in Vx from the value in Vy and stores it into Vx, if Vy > Vx then VF is set to
     //0, otherwise 1 (NOT borrow).
     uint8_t x = operands >> 8;
@@ -173,17 +195,26 @@ void SUBN(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uin
 }
 
 //8xyE - SHL Vx {, Vy}
-void SHL(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void SHL(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //If the most-significant bit is set to 1 then VF is set to 1, otherwise 0.
     //Then Vx is shifted to the left by one / multiplied by 2
     uint8_t x = operands >> 8;
-    //y is unused
-    regs.VF = regs.V[x] & 0x80; //0b10000000
-    regs.V[x] = regs.V[x] << 1;
+    uint8_t y = (operands >> 4) & 0xf;
+
+    if constexpr(Q::shift_vy) {
+        //The VIP shifts Vy and puts the result in Vx
+        uint8_t value = regs.V[y];
+        regs.V[x] = value << 1;
+        regs.VF = value >> 7;
+    } else {
+        regs.VF = regs.V[x] >> 7;
+        regs.V[x] = regs.V[x] << 1;
+    }
 }
 
 //9xy0 - SNE Vx, Vy
-void SNE_9(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void SNE_9(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Skip the next instruction if Vx is not equal to Vy
     uint8_t x = operands >> 8;
     uint8_t y = (operands >> 4) & 0xf;
@@ -192,74 +223,86 @@ void SNE_9(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, ui
 }
 
 //Annn - LD I, addr
-void LD_A(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_A(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //The value of register I is set to nnn
     regs.I = operands;
 }
 
 //Bnnn - JP V0, addr
-void JP_B(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
-    //Jump to / set PC to, nnn + V0
-    regs.PC = (operands + regs.V[0]) - 2;
+template<typename Q>
+void JP_B(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
+    //Jump to / set PC to, nnn + V0, or xnn + Vx on CHIP-48 and SUPER-CHIP
+    uint8_t x = Q::jump_vx ? operands >> 8 : 0;
+    regs.PC = (operands + regs.V[x]) - 2;
 }
 
 //Cxnn - RND Vx, byt
-void RND(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void RND(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Generate a random number and AND it with nn, then stores it in Vx.
     uint8_t x = operands >> 8;
     uint8_t nn = operands & 0xff;
-    regs.V[x] = (rand() % 255) & nn; //TODO: Use a better random number generator than rand()
+    regs.V[x] = static_cast<uint8_t>(nextRandom(regs.RNG) >> 24) & nn;
 }
 
 //Dxyn - DRW Vx, Vy, nibble
-void DRW(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void DRW(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Read an n byte sprite in from memory starting at I, then XOR them onto the screen
     //at (Vx, Vy)
     uint8_t x = operands >> 8;
     uint8_t y = (operands >> 4) & 0xf;
     uint8_t n = operands & 0xf;
-    regs.VF = 0;
+    uint8_t vx = regs.V[x];
+    uint8_t vy = regs.V[y];
+    uint64_t collision = 0;
 
     for(int i = 0; i < n; i++) {
-        uint8_t sprite_line = mem[regs.I + i];
-
-        for(int j = 0; j < 8; j++) {
-            if(sprite_line & (0x80 >> j)) {
-                //Screen wrapping
-                size_t pos = ((regs.V[x] + j) + (regs.V[y] + i) * CHIP8_SCREEN_WIDTH) % CHIP8_SCREEN_PIXELS;
-
-                //XOR the pixel and check for collision; Performing a NOT when the pixel is guaranteed to be 1
-                //is effectivally the same as an XOR.
-                regs.VF |= screen[pos] & 1;
-                screen[pos] = ~screen[pos];
-            }
+        //Each sprite line is rotated into place, so it wraps around the screen, then checked
+        //for collision with an AND and drawn with an XOR. When clipping, the sprite still
+        //starts at (Vx, Vy) wrapped onto the screen but nothing past the edges is drawn.
+        uint64_t sprite_row;
+        uint32_t row;
+
+        if constexpr(Q::clip) {
+            row = (vy & (CHIP8_SCREEN_HEIGHT - 1)) + i;
+            if(row >= CHIP8_SCREEN_HEIGHT) { break; }
+            sprite_row = clipSpriteRow(mem[wrapAddress(regs.I + i)], vx);
+        } else {
+            row = (vy + i) & (CHIP8_SCREEN_HEIGHT - 1);
+            sprite_row = placeSpriteRow(mem[wrapAddress(regs.I + i)], vx);
         }
+
+        uint64_t &screen_row = screen[row];
+        collision |= screen_row & sprite_row;
+        screen_row ^= sprite_row;
     }
+
+    regs.VF = collision != 0;
 }
 
 //Ex9E - SKP Vx
-void SKP(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
-    //Skip the next instruction if the key with the value in Vx is currently down
+void SKP(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
+    //Skip the next instruction if the key with the value in Vx is currently down, only the low nibble picks the key
     uint8_t x = operands >> 8;
-    regs.PC += keys[regs.V[x]] ? 2 : 0;
+    regs.PC += keys[regs.V[x] & 0xf] ? 2 : 0;
 }
 
 //ExA1 - SKNP Vx
-void SKNP(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
-    //Skip the next instruction if the key with the value in Vx is currently up
+void SKNP(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
+    //Skip the next instruction if the key with the value in Vx is currently up, only the low nibble picks the key
     uint8_t x = operands >> 8;
-    regs.PC += !keys[regs.V[x]] ? 2 : 0;
+    regs.PC += !keys[regs.V[x] & 0xf] ? 2 : 0;
 }
 
 //Fx07 - LD Vx, DT
-void LD_F07(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_F07(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Set Vx to the value in the Delay Timer
     uint8_t x = operands >> 8;
     regs.V[x] = regs.DT;
 }
 
 //Fx0A - LD Vx, K
-void LD_F0A(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_F0A(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Stop execution until a key is pressed, or in this case don't move on to the next instruction
     //until a key is pressed, then store the key pressed in Vx.
     uint8_t x = operands >> 8;
@@ -286,28 +329,28 @@ void LD_F0A(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, u
 }
 
 //Fx15 - LD DT, Vx
-void LD_F15(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_F15(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Set DT equal to the value in Vx
     uint8_t x = operands >> 8;
     regs.DT = regs.V[x];
 }
 
 //Fx18 - LD ST, Vx
-void LD_F18(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_F18(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Set the Sound Timer to the value in Vx
     uint8_t x = operands >> 8;
     regs.ST = regs.V[x];
 }
 
 //Fx1E - ADD I, Vx
-void ADD_F(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void ADD_F(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Add I and the value in Vx, then store the result in I
     uint8_t x = operands >> 8;
     regs.I += regs.V[x];
 }
 
 //Fx29 - LD F, Vx
-void LD_F29(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_F29(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Set I equal to the location of the hexadecimal digit corrosponding to the value in Vx
     uint8_t x = operands >> 8;
 
@@ -317,32 +360,61 @@ void LD_F29(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, u
 }
 
 //Fx33 - LD B, Vx
-void LD_F33(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void LD_F33(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Put the Binary Coded Decimal(BCD) form of the value in Vx into memory starting at I.
     //The hundreds place is put at I, the tens at I + 1, and the ones at I + 2.
     uint8_t x = operands >> 8;
     uint8_t hundreds = regs.V[x] / 100;
     uint8_t tens = regs.V[x] / 10 - hundreds * 10;
     uint8_t ones = regs.V[x] - (tens * 10 + hundreds * 100);
-    mem[regs.I] = hundreds;
-    mem[regs.I + 1] = tens;
-    mem[regs.I + 2] = ones;
+    mem[wrapAddress(regs.I)] = hundreds;
+    mem[wrapAddress(regs.I + 1)] = tens;
+    mem[wrapAddress(regs.I + 2)] = ones;
 }
 
 //Fx55 - LD [I], Vx
-void LD_F55(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void LD_F55(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Copy registers V0 through Vx into memory at the address stored in I
     uint8_t x = operands >> 8;
 
-    memcpy(mem + regs.I, regs.V, x + 1);
+    for(uint32_t i = 0; i <= x; i++) {
+        mem[wrapAddress(regs.I + i)] = regs.V[i];
+    }
+
+    regs.I += Q::indexStep(x);
 }
 
 //Fx65 - LD Vx, [I]
-void LD_F65(uint16_t operands, Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+template<typename Q>
+void LD_F65(uint16_t operands, Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     //Read registers V0 through Vx starting from the address stored in I
     uint8_t x = operands >> 8;
 
-    memcpy(regs.V, mem + regs.I, x + 1);
+    for(uint32_t i = 0; i <= x; i++) {
+        regs.V[i] = mem[wrapAddress(regs.I + i)];
+    }
+
+    regs.I += Q::indexStep(x);
 }
 
+//Every profile's version of the instructions that depend on quirks
+#define FISH_INSTANTIATE_QUIRKS(Q)                                                                                             \
+    template void OR<Q>    (uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void AND<Q>   (uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void XOR<Q>   (uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void SHR<Q>   (uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void SHL<Q>   (uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void JP_B<Q>  (uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void DRW<Q>   (uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void LD_F55<Q>(uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);                              \
+    template void LD_F65<Q>(uint16_t, Registers&, uint8_t*, uint64_t*, uint16_t*, const bool*);
+
+FISH_INSTANTIATE_QUIRKS(ModernQuirks)
+FISH_INSTANTIATE_QUIRKS(CosmacVipQuirks)
+FISH_INSTANTIATE_QUIRKS(Chip48Quirks)
+FISH_INSTANTIATE_QUIRKS(SchipQuirks)
+
+#undef FISH_INSTANTIATE_QUIRKS
+
 }
\ No newline at end of file
@@ -5,20 +5,28 @@
 
 namespace fish {
 
+//The instruction function table with the quirky instructions from profile Q
+template<typename Q>
+static std::array<InstructionFunc, OP_COUNT> instructionTable() {
+    return {
+        NOP,       CLS,       RET,       JP_1,
+        CALL,      SE_3,      SNE_4,     SE_5,
+        LD_6,      ADD_7,     LD_8,      OR<Q>,
+        AND<Q>,    XOR<Q>,    ADD_8,     SUB,
+        SHR<Q>,    SUBN,      SHL<Q>,    SNE_9,
+        LD_A,      JP_B<Q>,   RND,       DRW<Q>,
+        SKP,       SKNP,      LD_F07,    LD_F0A,
+        LD_F15,    LD_F18,    ADD_F,     LD_F29,
+        LD_F33,    LD_F55<Q>, LD_F65<Q>
+    };
+}
+
 Interpreter::Interpreter() {
     m_opcode = 0;
     m_operands = 0;
-    m_instructions = {
-        NOP,    CLS,    RET,    JP_1,
-        CALL,   SE_3,   SNE_4,  SE_5, 
-        LD_6,   ADD_7,  LD_8,   OR, 
-        AND,    XOR,    ADD_8,  SUB, 
-        SHR,    SUBN,   SHL,    SNE_9, 
-        LD_A,   JP_B,   RND,    DRW, 
-        SKP,    SKNP,   LD_F07, LD_F0A, 
-        LD_F15, LD_F18, ADD_F,  LD_F29, 
-        LD_F33, LD_F55, LD_F65
-    };
+    setQuirks(MODERN_QUIRKS);
+
+    invalidateAll();
 }
 
 Interpreter::~Interpreter() { }
@@ -127,8 +135,40 @@ void Interpreter::decode(uint16_t instr) {
     }
 }
 
-void Interpreter::execute(Registers &regs, uint8_t *mem, uint8_t *screen, uint16_t *stack, const bool *keys) {
+void Interpreter::setQuirks(QuirkProfile profile) {
+    m_instructions = withQuirks(profile, [](auto quirks) { return instructionTable<decltype(quirks)>(); });
+}
+
+void Interpreter::execute(Registers &regs, uint8_t *mem, uint64_t *screen, uint16_t *stack, const bool *keys) {
     m_instructions[m_opcode](m_operands, regs, mem, screen, stack, keys);
 }
 
+void Interpreter::fill(DecodedInstruction &entry, const uint8_t *mem, uint16_t address) {
+    //The second byte wraps around to the start of memory for an instruction at 0xfff
+    uint16_t instr = (mem[address] << 8) | mem[(address + 1) & (CHIP8_MEM_SIZE - 1)];
+    decode(instr);
+
+    entry.opcode = m_opcode;
+    entry.x      = (m_operands >> 8) & 0xf;
+    entry.y      = (m_operands >> 4) & 0xf;
+    entry.n      = m_operands & 0xf;
+    entry.nn     = m_operands & 0xff;
+    entry.nnn    = m_operands;
+}
+
+void Interpreter::invalidate(uint16_t address, uint16_t length) {
+    if(length == 0) { return; }
+
+    //The instruction starting one byte before the write also reads the first byte written
+    for(uint32_t i = 0; i <= length; i++) {
+        m_cache[(address + i - 1) & (CHIP8_MEM_SIZE - 1)].opcode = OP_UNDECODED;
+    }
+}
+
+void Interpreter::invalidateAll() {
+    for(DecodedInstruction &entry : m_cache) {
+        entry.opcode = OP_UNDECODED;
+    }
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "Movie.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "Log.hpp"
+#include "SaveState.hpp"
+
+namespace fish {
+
+uint16_t packKeys(const bool keys[CHIP8_NUM_KEYS]) {
+    uint16_t mask = 0;
+
+    for(uint32_t i = 0; i < CHIP8_NUM_KEYS; i++) {
+        mask |= static_cast<uint16_t>(keys[i]) << i;
+    }
+
+    return mask;
+}
+
+void unpackKeys(uint16_t mask, bool keys[CHIP8_NUM_KEYS]) {
+    for(uint32_t i = 0; i < CHIP8_NUM_KEYS; i++) {
+        keys[i] = (mask >> i) & 1;
+    }
+}
+
+std::vector<uint8_t> serializeMovie(const Movie &movie) {
+    std::vector<uint8_t> out;
+    StateWriter writer(out);
+
+    writer.put32(MOVIE_MAGIC);
+    writer.put32(MOVIE_VERSION);
+
+    //Version 1
+    writer.put64(movie.rom_hash);
+    writer.put8(static_cast<uint8_t>(movie.quirks));
+    writer.put32(movie.clock_rate);
+    writer.put64(movie.rng_seed);
+    writer.put64(movie.end_cycle);
+
+    writer.put32(static_cast<uint32_t>(movie.inputs.size()));
+    for(const MovieInput &input : movie.inputs) {
+        writer.put64(input.cycle);
+        writer.put16(input.keys);
+    }
+
+    //Keyframes are whole save states, sized so a reader can skip one it can't use
+    writer.put32(static_cast<uint32_t>(movie.keyframes.size()));
+    for(const MovieKeyframe &keyframe : movie.keyframes) {
+        std::vector<uint8_t> state = serializeState(keyframe.state);
+
+        writer.put32(keyframe.input);
+        writer.put16(keyframe.keys);
+        writer.put32(static_cast<uint32_t>(state.size()));
+        writer.putBytes(state.data(), state.size());
+    }
+
+    return out;
+}
+
+StatusCode deserializeMovie(const uint8_t *data, size_t size, Movie &movie) {
+    StateReader reader(data, size);
+
+    if(reader.get32() != MOVIE_MAGIC) {
+        LOG_WARN("[EMU]: Not a movie");
+        return INVALID_STATE;
+    }
+
+    uint32_t version = reader.get32();
+    if(version == 0 || version > MOVIE_VERSION) {
+        LOG_WARN("[EMU]: Movie version %d is not supported, the newest is %d", version, MOVIE_VERSION);
+        return INVALID_STATE;
+    }
+
+    Movie loaded;
+    loaded.rom_hash = reader.get64();
+    loaded.quirks = static_cast<QuirkProfile>(reader.get8());
+    loaded.clock_rate = reader.get32();
+    loaded.rng_seed = reader.get64();
+    loaded.end_cycle = reader.get64();
+
+    if(loaded.quirks > SCHIP_QUIRKS || loaded.clock_rate == 0) {
+        LOG_WARN("[EMU]: Movie has an invalid quirk profile or clock rate");
+        return INVALID_STATE;
+    }
+
+    //Counts are checked against what is left so a corrupt one can't allocate gigabytes
+    uint32_t num_inputs = reader.get32();
+    if(num_inputs > reader.remaining() / 10) {
+        LOG_WARN("[EMU]: Movie is truncated");
+        return INVALID_STATE;
+    }
+
+    loaded.inputs.resize(num_inputs);
+    for(MovieInput &input : loaded.inputs) {
+        input.cycle = reader.get64();
+        input.keys = reader.get16();
+    }
+
+    uint32_t num_keyframes = reader.get32();
+    if(num_keyframes == 0 || num_keyframes > reader.remaining() / 10) {
+        LOG_WARN("[EMU]: Movie has no keyframes or is truncated");
+        return INVALID_STATE;
+    }
+
+    loaded.keyframes.resize(num_keyframes);
+    for(MovieKeyframe &keyframe : loaded.keyframes) {
+        keyframe.input = reader.get32();
+        keyframe.keys = reader.get16();
+
+        std::vector<uint8_t> state(std::min<size_t>(reader.get32(), reader.remaining()));
+        reader.getBytes(state.data(), state.size());
+
+        if(!reader.good() || keyframe.input > num_inputs || deserializeState(state.data(), state.size(), keyframe.state) != OK) {
+            LOG_WARN("[EMU]: Movie has an invalid keyframe");
+            return INVALID_STATE;
+        }
+    }
+
+    if(!reader.good()) {
+        LOG_WARN("[EMU]: Movie is truncated");
+        return INVALID_STATE;
+    }
+
+    movie = std::move(loaded);
+    return OK;
+}
+
+StatusCode saveMovieFile(const std::string &path, const Movie &movie) {
+    std::vector<uint8_t> data = serializeMovie(movie);
+
+    std::ofstream fstream(path, std::ios::binary);
+    fstream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    if(!fstream.good()) {
+        LOG_WARN("[EMU]: Could not write movie %s", base_name(path));
+        return FILE_NOT_GOOD;
+    }
+
+    return OK;
+}
+
+StatusCode loadMovieFile(const std::string &path, Movie &movie) {
+    if(!std::filesystem::exists(path)) {
+        LOG_WARN("[EMU]: Movie %s was not found", base_name(path));
+        return FILE_NOT_FOUND;
+    }
+
+    std::ifstream fstream(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(fstream)), std::istreambuf_iterator<char>());
+
+    if(fstream.bad()) {
+        LOG_WARN("[EMU]: Movie %s could not be loaded because filestream is not good", base_name(path));
+        return FILE_NOT_GOOD;
+    }
+
+    return deserializeMovie(data.data(), data.size(), movie);
+}
+
+MovieRecorder::MovieRecorder() {
+    m_recording = false;
+    m_keys = 0;
+    m_keyframe_interval = 0;
+    m_next_keyframe = 0;
+}
+
+void MovieRecorder::addKeyframe(const Chip8 &emu) {
+    MovieKeyframe keyframe;
+    keyframe.input = static_cast<uint32_t>(m_movie.inputs.size());
+    keyframe.keys = m_keys;
+    emu.saveState(keyframe.state);
+
+    m_movie.keyframes.push_back(keyframe);
+    m_next_keyframe = keyframe.state.cycles + m_keyframe_interval;
+}
+
+void MovieRecorder::start(const Chip8 &emu, uint64_t keyframe_interval) {
+    m_movie = Movie();
+    m_movie.rom_hash = emu.getRomInfo().hash;
+    m_movie.quirks = emu.getQuirkProfile();
+    m_movie.clock_rate = emu.getClockRate();
+    m_movie.rng_seed = emu.getRandomSeed();
+
+    m_recording = true;
+    m_keys = 0;
+    m_keyframe_interval = std::max<uint64_t>(1, keyframe_interval);
+
+    addKeyframe(emu);
+}
+
+void MovieRecorder::update(const Chip8 &emu, const bool keys[CHIP8_NUM_KEYS]) {
+    if(!m_recording) {
+        return;
+    }
+
+    uint64_t now = emu.getCycleCount();
+
+    //Taken before this cycle's input, so the keyframe holds the keys that led up to it
+    if(now >= m_next_keyframe) {
+        addKeyframe(emu);
+    }
+
+    uint16_t mask = packKeys(keys);
+    if(mask != m_keys) {
+        //Two changes on the same cycle, only the last one ever took effect
+        if(!m_movie.inputs.empty() && m_movie.inputs.back().cycle == now && m_movie.keyframes.back().input < m_movie.inputs.size()) {
+            m_movie.inputs.back().keys = mask;
+        } else {
+            m_movie.inputs.push_back({now, mask});
+        }
+
+        m_keys = mask;
+    }
+}
+
+void MovieRecorder::truncate(const Chip8 &emu) {
+    if(!m_recording) {
+        return;
+    }
+
+    uint64_t now = emu.getCycleCount();
+
+    //Rewound past the start, the recording starts over from here
+    if(now < m_movie.keyframes.front().state.cycles) {
+        start(emu, m_keyframe_interval);
+        return;
+    }
+
+    while(!m_movie.inputs.empty() && m_movie.inputs.back().cycle >= now) {
+        m_movie.inputs.pop_back();
+    }
+
+    while(m_movie.keyframes.size() > 1 && m_movie.keyframes.back().state.cycles > now) {
+        m_movie.keyframes.pop_back();
+    }
+
+    m_keys = m_movie.inputs.empty() ? m_movie.keyframes.front().keys : m_movie.inputs.back().keys;
+    m_next_keyframe = m_movie.keyframes.back().state.cycles + m_keyframe_interval;
+}
+
+Movie MovieRecorder::stop(const Chip8 &emu) {
+    m_movie.end_cycle = emu.getCycleCount();
+    m_recording = false;
+
+    return std::move(m_movie);
+}
+
+bool MovieRecorder::isRecording() const {
+    return m_recording;
+}
+
+const Movie& MovieRecorder::getMovie() const {
+    return m_movie;
+}
+
+MoviePlayer::MoviePlayer() {
+    m_playing = false;
+    m_keys = 0;
+    m_next_input = 0;
+}
+
+StatusCode MoviePlayer::start(Chip8 &emu, Movie movie) {
+    if(movie.rom_hash != emu.getRomInfo().hash) {
+        LOG_WARN("[EMU]: Movie was recorded with a different ROM");
+        return INVALID_STATE;
+    }
+
+    if(movie.keyframes.empty()) {
+        LOG_WARN("[EMU]: Movie has no keyframes");
+        return INVALID_STATE;
+    }
+
+    m_movie = std::move(movie);
+    m_playing = true;
+
+    emu.setQuirkProfile(m_movie.quirks);
+    emu.setClockRate(m_movie.clock_rate);
+    emu.setTimerMode(CYCLE_TIMERS);
+    emu.setRandomSeed(m_movie.rng_seed);
+
+    seek(emu, m_movie.keyframes.front().state.cycles);
+    return OK;
+}
+
+void MoviePlayer::seek(Chip8 &emu, uint64_t cycle) {
+    if(!m_playing) {
+        return;
+    }
+
+    //The last keyframe at or before cycle, the first one if cycle is before the movie starts
+    auto after = std::upper_bound(m_movie.keyframes.begin(), m_movie.keyframes.end(), cycle, [](uint64_t cycle, const MovieKeyframe &keyframe) {
+        return cycle < keyframe.state.cycles;
+    });
+    const MovieKeyframe &keyframe = after == m_movie.keyframes.begin() ? *after : *(after - 1);
+
+    emu.loadState(keyframe.state);
+    m_keys = keyframe.keys;
+    m_next_input = keyframe.input;
+
+    uint64_t now = emu.getCycleCount();
+    if(cycle > now) {
+        run(emu, cycle - now);
+    }
+}
+
+uint64_t MoviePlayer::run(Chip8 &emu, uint64_t cycles) {
+    if(!m_playing) {
+        return 0;
+    }
+
+    uint64_t start = emu.getCycleCount();
+    uint64_t end = std::max(m_movie.end_cycle, start);
+    if(cycles < end - start) {
+        end = start + cycles;
+    }
+    bool keys[CHIP8_NUM_KEYS];
+
+    //Run up to each input, apply it, and carry on until the end
+    while(emu.getCycleCount() < end) {
+        uint64_t now = emu.getCycleCount();
+
+        while(m_next_input < m_movie.inputs.size() && m_movie.inputs[m_next_input].cycle <= now) {
+            m_keys = m_movie.inputs[m_next_input].keys;
+            m_next_input++;
+        }
+
+        uint64_t stop = end;
+        if(m_next_input < m_movie.inputs.size()) {
+            stop = std::min(stop, m_movie.inputs[m_next_input].cycle);
+        }
+
+        //cycle() takes a 32-bit count
+        unpackKeys(m_keys, keys);
+        emu.cycle(static_cast<uint32_t>(std::min<uint64_t>(stop - now, UINT32_MAX)), keys);
+    }
+
+    return emu.getCycleCount() - start;
+}
+
+void MoviePlayer::stop() {
+    m_playing = false;
+}
+
+bool MoviePlayer::isPlaying() const {
+    return m_playing;
+}
+
+bool MoviePlayer::isFinished(const Chip8 &emu) const {
+    return emu.getCycleCount() >= m_movie.end_cycle;
+}
+
+const Movie& MoviePlayer::getMovie() const {
+    return m_movie;
+}
+
+}
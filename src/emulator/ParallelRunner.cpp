@@ -0,0 +1,242 @@
+#include "ParallelRunner.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Chip8.hpp"
+
+namespace fish {
+
+WorkDeque::WorkDeque() {
+    m_capacity = 0;
+    reset(1);
+}
+
+void WorkDeque::reset(size_t capacity) {
+    //Only ever grows, so running the same number of machines again doesn't allocate
+    if(capacity > m_capacity) {
+        m_items.reset(new std::atomic<uint32_t>[capacity]);
+        m_capacity = capacity;
+    }
+
+    m_top.store(0);
+    m_bottom.store(0);
+}
+
+void WorkDeque::push(uint32_t item) {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    m_items[bottom % m_capacity].store(item, std::memory_order_relaxed);
+
+    //The item has to be visible before a thief can see the new bottom
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+}
+
+uint32_t WorkDeque::pop() {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if(top > bottom) {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return EMPTY;
+    }
+
+    uint32_t item = m_items[bottom % m_capacity].load(std::memory_order_relaxed);
+
+    //The last item can be stolen at the same time, whoever moves top first gets it
+    if(top == bottom) {
+        if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            item = EMPTY;
+        }
+
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return item;
+}
+
+uint32_t WorkDeque::steal() {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if(top >= bottom) {
+        return EMPTY;
+    }
+
+    uint32_t item = m_items[top % m_capacity].load(std::memory_order_relaxed);
+    if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return EMPTY;
+    }
+
+    return item;
+}
+
+ParallelRunner::ParallelRunner(uint32_t threads) {
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_generation = 0;
+    m_busy = 0;
+    m_quit = false;
+    m_machines = nullptr;
+    m_results = nullptr;
+    m_unfinished = 0;
+
+    m_steals.reset(new std::atomic<uint64_t>[threads]);
+    for(uint32_t i = 0; i < threads; i++) {
+        m_deques.emplace_back(new WorkDeque());
+        m_steals[i] = 0;
+    }
+
+    for(uint32_t i = 0; i < threads; i++) {
+        m_threads.emplace_back(&ParallelRunner::workerLoop, this, i);
+    }
+}
+
+ParallelRunner::~ParallelRunner() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_start.notify_all();
+
+    for(std::thread &thread : m_threads) {
+        thread.join();
+    }
+}
+
+uint32_t ParallelRunner::getThreadCount() const {
+    return static_cast<uint32_t>(m_threads.size());
+}
+
+void ParallelRunner::run(Chip8 *const *machines, size_t count, const RunBudget &budget, RunResult *results) {
+    if(count == 0) { return; }
+
+    const uint32_t threads = getThreadCount();
+
+    //Deal the machines out round robin, every deque can hold all of them since any worker might
+    //end up with the lot after stealing
+    for(uint32_t i = 0; i < threads; i++) {
+        m_deques[i]->reset(count);
+        m_steals[i] = 0;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        results[i] = RunResult();
+        m_deques[i % threads]->push(static_cast<uint32_t>(i));
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_machines = machines;
+    m_results = results;
+    m_budget = budget;
+    m_budget.quantum = std::max(1u, budget.quantum);
+    m_unfinished = count;
+    m_busy = threads;
+    m_generation++;
+
+    m_start.notify_all();
+    m_done.wait(lock, [this] { return m_busy == 0; });
+}
+
+uint64_t ParallelRunner::getStealCount() const {
+    uint64_t steals = 0;
+    for(uint32_t i = 0; i < getThreadCount(); i++) {
+        steals += m_steals[i].load(std::memory_order_relaxed);
+    }
+
+    return steals;
+}
+
+void ParallelRunner::workerLoop(uint32_t index) {
+    uint64_t seen = 0;
+
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&] { return m_quit || m_generation != seen; });
+
+            if(m_quit) { return; }
+            seen = m_generation;
+        }
+
+        runMachines(index);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+
+        m_done.notify_one();
+    }
+}
+
+void ParallelRunner::runMachines(uint32_t index) {
+    WorkDeque &own = *m_deques[index];
+    const uint32_t threads = getThreadCount();
+
+    while(m_unfinished.load(std::memory_order_acquire) > 0) {
+        uint32_t machine = own.pop();
+
+        //Out of work, look through the others starting with the next worker along
+        for(uint32_t i = 1; i < threads && machine == WorkDeque::EMPTY; i++) {
+            machine = m_deques[(index + i) % threads]->steal();
+            if(machine != WorkDeque::EMPTY) { m_steals[index].fetch_add(1, std::memory_order_relaxed); }
+        }
+
+        //Everything left is being run by other workers right now. Each of them takes its machine
+        //straight back out of its own deque, so there is nothing more for this one to do.
+        if(machine == WorkDeque::EMPTY) {
+            return;
+        }
+
+        if(runSlice(index, machine)) {
+            m_unfinished.fetch_sub(1, std::memory_order_acq_rel);
+        } else {
+            own.push(machine);
+        }
+    }
+}
+
+bool ParallelRunner::runSlice(uint32_t index, uint32_t machine) {
+    static const bool keys[CHIP8_NUM_KEYS] = {};
+
+    Chip8 &emu = *m_machines[machine];
+    RunResult &result = m_results[machine];
+
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+
+    do {
+        uint32_t num = static_cast<uint32_t>(std::min<uint64_t>(m_budget.quantum, m_budget.cycles - result.cycles));
+        uint64_t idle = emu.getIdleCycleCount();
+
+        emu.cycle(num, keys);
+
+        result.cycles += num;
+        result.idle_cycles += emu.getIdleCycleCount() - idle;
+        result.quanta++;
+
+        //Same FNV-1a step as the screen hash itself, over the 64-bit hash a byte at a time
+        uint64_t screen_hash = emu.getScreenHash();
+        for(uint32_t shift = 0; shift < 64; shift += 8) {
+            result.frame_hash ^= (screen_hash >> shift) & 0xff;
+            result.frame_hash *= 0x100000001b3;
+        }
+
+        result.screen_hash = screen_hash;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while(result.cycles < m_budget.cycles && elapsed < m_budget.slice);
+
+    result.seconds += elapsed;
+    result.worker = index;
+
+    return result.cycles >= m_budget.cycles;
+}
+
+}
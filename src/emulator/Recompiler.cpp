@@ -0,0 +1,413 @@
+#include "Recompiler.hpp"
+
+#include <cstring>
+#include <cstddef>
+#include <initializer_list>
+
+#include "Chip8.hpp"
+#include "Interpreter.hpp"
+#include "Log.hpp"
+#include "Quirks.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FISH_JIT_X64 1
+#else
+#define FISH_JIT_X64 0
+#endif
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace fish {
+
+//Register offsets used as 8-bit displacements from the Registers pointer
+static const uint8_t REG_VF = 0xf;
+static const uint8_t REG_I  = static_cast<uint8_t>(offsetof(Registers, I));
+static const uint8_t REG_PC = static_cast<uint8_t>(offsetof(Registers, PC));
+
+//Instructions that end a block, they are compiled and decide where PC goes next
+static bool isTerminator(uint8_t opcode) {
+    switch(opcode) {
+        case OP_JP_1 :
+        case OP_SE_3 :
+        case OP_SNE_4 :
+        case OP_SE_5 :
+        case OP_SNE_9 :
+        case OP_SKP :
+        case OP_SKNP : return true;
+    }
+
+    return false;
+}
+
+static bool isCompilable(uint8_t opcode) {
+    switch(opcode) {
+        case OP_NOP :
+        case OP_LD_6 :
+        case OP_ADD_7 :
+        case OP_LD_8 :
+        case OP_OR :
+        case OP_AND :
+        case OP_XOR :
+        case OP_ADD_8 :
+        case OP_SUB :
+        case OP_SHR :
+        case OP_SUBN :
+        case OP_SHL :
+        case OP_LD_A :
+        case OP_ADD_F :
+        case OP_LD_F29 :
+        case OP_LD_F65 : return true;
+    }
+
+    return isTerminator(opcode);
+}
+
+//x86-64 encoding helpers. While a block runs rdi holds the Registers pointer, rsi the keys,
+//and rdx Chip-8 memory. al and cl are used as scratch registers.
+static void put(std::vector<uint8_t> &code, std::initializer_list<uint8_t> bytes) {
+    code.insert(code.end(), bytes);
+}
+
+static void loadAL(std::vector<uint8_t> &code, uint8_t reg)  { put(code, {0x8a, 0x47, reg}); } //mov al, [rdi + reg]
+static void storeAL(std::vector<uint8_t> &code, uint8_t reg) { put(code, {0x88, 0x47, reg}); } //mov [rdi + reg], al
+static void storeCL(std::vector<uint8_t> &code, uint8_t reg) { put(code, {0x88, 0x4f, reg}); } //mov [rdi + reg], cl
+
+static void setPC(std::vector<uint8_t> &code, uint16_t value) {
+    //mov word [rdi + PC], value
+    put(code, {0x66, 0xc7, 0x47, REG_PC, static_cast<uint8_t>(value & 0xff), static_cast<uint8_t>(value >> 8)});
+}
+
+static void prologue(std::vector<uint8_t> &code) {
+#if defined(_WIN32)
+    //The Windows calling convention passes arguments in rcx, rdx, r8, and rdi and rsi are callee saved
+    put(code, {0x57, 0x56});             //push rdi; push rsi
+    put(code, {0x48, 0x89, 0xcf});       //mov rdi, rcx
+    put(code, {0x48, 0x89, 0xd6});       //mov rsi, rdx
+    put(code, {0x4c, 0x89, 0xc2});       //mov rdx, r8
+#endif
+}
+
+static void epilogue(std::vector<uint8_t> &code) {
+#if defined(_WIN32)
+    put(code, {0x5e, 0x5f});             //pop rsi; pop rdi
+#endif
+    put(code, {0xc3});                   //ret
+}
+
+//Sets PC to the next instruction, or the one after it if the condition code jcc (as the opcode
+//of a short jump that skips over the second PC store) is not taken
+static void skipUnless(std::vector<uint8_t> &code, uint8_t jcc, uint16_t address) {
+    put(code, {jcc, 0x06});
+    setPC(code, address + 4);
+}
+
+//The code buffer is never writable and executable at the same time, it is switched to
+//read-write while a block is copied in and back to read-execute before anything runs
+static bool protectBuffer(uint8_t *buffer, size_t size, bool writable) {
+#if defined(_WIN32)
+    DWORD old;
+    return VirtualProtect(buffer, size, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &old) != 0;
+#else
+    return mprotect(buffer, size, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#endif
+}
+
+Recompiler::Recompiler() {
+    m_buffer = nullptr;
+    m_used = 0;
+    m_quirks = MODERN_QUIRKS;
+    invalidateAll();
+}
+
+Recompiler::~Recompiler() {
+    if(m_buffer != nullptr) {
+#if defined(_WIN32)
+        VirtualFree(m_buffer, 0, MEM_RELEASE);
+#else
+        munmap(m_buffer, BUFFER_SIZE);
+#endif
+    }
+}
+
+bool Recompiler::isSupported() {
+    return FISH_JIT_X64;
+}
+
+void Recompiler::invalidate(uint16_t address, uint16_t length) {
+    //Check every block that could reach the written range, blocks are at most MAX_BLOCK_LENGTH instructions long
+    uint32_t start = address >= MAX_BLOCK_LENGTH * 2 ? address - MAX_BLOCK_LENGTH * 2 : 0;
+    uint32_t end = address + length;
+
+    for(uint32_t i = start; i < end && i < CHIP8_MEM_SIZE; i++) {
+        Block &block = m_blocks[i];
+        uint32_t bytes = block.state == COMPILED ? block.bytes : 2;
+
+        if(block.state != UNCOMPILED && i + bytes > address) {
+            block.state = UNCOMPILED;
+        }
+    }
+}
+
+void Recompiler::invalidateAll() {
+    for(Block &block : m_blocks) {
+        block = {nullptr, 0, 0, UNCOMPILED};
+    }
+
+    m_used = 0;
+}
+
+void Recompiler::setQuirks(QuirkProfile profile) {
+    if(profile != m_quirks) {
+        m_quirks = profile;
+        invalidateAll();
+    }
+}
+
+const Block* Recompiler::compile(Interpreter &interpreter, const uint8_t *mem, uint16_t address) {
+    Block &block = m_blocks[address];
+
+    if(!isSupported()) {
+        block.state = UNCOMPILABLE;
+        return nullptr;
+    }
+
+    m_code.clear();
+    prologue(m_code);
+
+    //Instructions at the very end of memory wrap around, so they are left to the interpreter
+    uint16_t pc = address;
+    uint8_t length = 0;
+    bool ended = false;
+
+    while(!ended && length < MAX_BLOCK_LENGTH && pc < CHIP8_MEM_SIZE - 1) {
+        const DecodedInstruction &instr = interpreter.fetch(mem, pc);
+        if(!isCompilable(instr.opcode)) { break; }
+
+        //Blocks are specialized for the profile, so quirks are only looked at while compiling
+        ended = withQuirks(m_quirks, [&](auto quirks) { return emit<decltype(quirks)>(instr, pc); });
+        length++;
+        pc += 2;
+    }
+
+    if(length == 0) {
+        block.state = UNCOMPILABLE;
+        return nullptr;
+    }
+
+    //The block stopped before something it couldn't compile, continue from there
+    if(!ended) {
+        setPC(m_code, pc);
+        epilogue(m_code);
+    }
+
+    if(m_buffer == nullptr) {
+#if defined(_WIN32)
+        m_buffer = reinterpret_cast<uint8_t*>(VirtualAlloc(nullptr, BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+        void *buffer = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        m_buffer = buffer == MAP_FAILED ? nullptr : reinterpret_cast<uint8_t*>(buffer);
+#endif
+
+        if(m_buffer == nullptr) {
+            LOG_WARN("[JIT]: Failed to allocate executable memory, falling back to the interpreter");
+            block.state = UNCOMPILABLE;
+            return nullptr;
+        }
+    }
+
+    //Start over once the buffer is full, which throws away every compiled block
+    if(m_used + m_code.size() > BUFFER_SIZE) {
+        invalidateAll();
+    }
+
+    if(!protectBuffer(m_buffer, BUFFER_SIZE, true)) {
+        LOG_WARN("[JIT]: Failed to make the code buffer writable, interpreting the block");
+        block.state = UNCOMPILABLE;
+        return nullptr;
+    }
+
+    memcpy(m_buffer + m_used, m_code.data(), m_code.size());
+
+    if(!protectBuffer(m_buffer, BUFFER_SIZE, false)) {
+        LOG_WARN("[JIT]: Failed to make the code buffer executable, interpreting the block");
+        block.state = UNCOMPILABLE;
+        return nullptr;
+    }
+
+    block.code = reinterpret_cast<BlockFunc>(m_buffer + m_used);
+    block.bytes = pc - address;
+    block.length = length;
+    block.state = COMPILED;
+
+    //Keep blocks 16 byte aligned
+    m_used = (m_used + m_code.size() + 15) & ~static_cast<size_t>(15);
+
+    return &block;
+}
+
+//Emits the code for one instruction with the same semantics as its function in Instruction.cpp
+//for quirk profile Q, returns true if the instruction ends the block
+template<typename Q>
+bool Recompiler::emit(const DecodedInstruction &instr, uint16_t address) {
+    std::vector<uint8_t> &c = m_code;
+    uint8_t x = instr.x;
+    uint8_t y = instr.y;
+    uint8_t nn = instr.nn;
+
+    switch(instr.opcode) {
+        case OP_NOP : break;
+
+        case OP_LD_6 : put(c, {0xc6, 0x47, x, nn}); break;  //mov byte [Vx], nn
+        case OP_ADD_7 : put(c, {0x80, 0x47, x, nn}); break; //add byte [Vx], nn
+
+        case OP_LD_8 : loadAL(c, y); storeAL(c, x); break;
+        case OP_OR :
+        case OP_AND :
+        case OP_XOR :
+            loadAL(c, y);
+            if(instr.opcode == OP_OR) { put(c, {0x08, 0x47, x}); }       //or [Vx], al
+            else if(instr.opcode == OP_AND) { put(c, {0x20, 0x47, x}); } //and [Vx], al
+            else { put(c, {0x30, 0x47, x}); }                            //xor [Vx], al
+
+            if constexpr(Q::reset_vf) { put(c, {0xc6, 0x47, REG_VF, 0x00}); }      //mov byte [VF], 0
+        break;
+
+        case OP_ADD_8 :
+            loadAL(c, x);
+            put(c, {0x02, 0x47, y});       //add al, [Vy]
+            put(c, {0x0f, 0x92, 0xc1});    //setc cl
+            storeCL(c, REG_VF);
+            storeAL(c, x);
+        break;
+
+        case OP_SUB :
+            loadAL(c, x);
+            put(c, {0x3a, 0x47, y});       //cmp al, [Vy]
+            put(c, {0x0f, 0x97, 0xc1});    //seta cl
+            put(c, {0x2a, 0x47, y});       //sub al, [Vy]
+            storeCL(c, REG_VF);
+            storeAL(c, x);
+        break;
+
+        case OP_SHR :
+            if constexpr(Q::shift_vy) {
+                //Vx is written before VF, so the flag wins if x is F
+                loadAL(c, y);
+                put(c, {0x88, 0xc1});      //mov cl, al
+                put(c, {0x80, 0xe1, 0x01}); //and cl, 1
+                put(c, {0xd0, 0xe8});      //shr al, 1
+                storeAL(c, x);
+                storeCL(c, REG_VF);
+            } else {
+                //VF is written first, so Vx is read again in case it is VF
+                loadAL(c, x);
+                put(c, {0x24, 0x01});      //and al, 1
+                storeAL(c, REG_VF);
+                loadAL(c, x);
+                put(c, {0xd0, 0xe8});      //shr al, 1
+                storeAL(c, x);
+            }
+        break;
+
+        case OP_SUBN :
+            loadAL(c, y);
+            put(c, {0x3a, 0x47, x});       //cmp al, [Vx]
+            put(c, {0x0f, 0x96, 0xc1});    //setbe cl
+            storeCL(c, REG_VF);
+            loadAL(c, y);
+            put(c, {0x2a, 0x47, x});       //sub al, [Vx]
+            storeAL(c, x);
+        break;
+
+        case OP_SHL :
+            if constexpr(Q::shift_vy) {
+                loadAL(c, y);
+                put(c, {0x88, 0xc1});      //mov cl, al
+                put(c, {0xc0, 0xe9, 0x07}); //shr cl, 7
+                put(c, {0x00, 0xc0});      //add al, al
+                storeAL(c, x);
+                storeCL(c, REG_VF);
+            } else {
+                loadAL(c, x);
+                put(c, {0xc0, 0xe8, 0x07}); //shr al, 7
+                storeAL(c, REG_VF);
+                loadAL(c, x);
+                put(c, {0x00, 0xc0});      //add al, al
+                storeAL(c, x);
+            }
+        break;
+
+        case OP_LD_A :
+            //mov word [I], nnn
+            put(c, {0x66, 0xc7, 0x47, REG_I, static_cast<uint8_t>(instr.nnn & 0xff), static_cast<uint8_t>(instr.nnn >> 8)});
+        break;
+
+        case OP_ADD_F :
+            put(c, {0x0f, 0xb6, 0x47, x});        //movzx eax, byte [Vx]
+            put(c, {0x66, 0x01, 0x47, REG_I});    //add [I], ax
+        break;
+
+        case OP_LD_F29 :
+            put(c, {0x0f, 0xb6, 0x47, x});        //movzx eax, byte [Vx]
+            put(c, {0x8d, 0x04, 0x80});           //lea eax, [rax + rax * 4]
+            put(c, {0x66, 0x89, 0x47, REG_I});    //mov [I], ax
+        break;
+
+        case OP_LD_F65 :
+            put(c, {0x0f, 0xb7, 0x4f, REG_I});    //movzx ecx, word [I]
+            for(uint8_t k = 0; k <= x; k++) {
+                //Addresses wrap around the end of memory
+                put(c, {0x8d, 0x41, k});                  //lea eax, [rcx + k]
+                put(c, {0x25, 0xff, 0x0f, 0x00, 0x00});   //and eax, 0xfff
+                put(c, {0x8a, 0x04, 0x02});               //mov al, [rdx + rax]
+                storeAL(c, k);
+            }
+
+            if(Q::indexStep(x) > 0) {
+                put(c, {0x66, 0x83, 0x47, REG_I, static_cast<uint8_t>(Q::indexStep(x))}); //add word [I], step
+            }
+        break;
+
+        case OP_JP_1 :
+            setPC(c, instr.nnn);
+            epilogue(c);
+        return true;
+
+        case OP_SE_3 :
+        case OP_SNE_4 :
+            setPC(c, address + 2);
+            put(c, {0x80, 0x7f, x, nn});          //cmp byte [Vx], nn
+            skipUnless(c, instr.opcode == OP_SE_3 ? 0x75 : 0x74, address); //jne / je
+            epilogue(c);
+        return true;
+
+        case OP_SE_5 :
+        case OP_SNE_9 :
+            setPC(c, address + 2);
+            loadAL(c, x);
+            put(c, {0x3a, 0x47, y});              //cmp al, [Vy]
+            skipUnless(c, instr.opcode == OP_SE_5 ? 0x75 : 0x74, address); //jne / je
+            epilogue(c);
+        return true;
+
+        case OP_SKP :
+        case OP_SKNP :
+            setPC(c, address + 2);
+            put(c, {0x0f, 0xb6, 0x47, x});        //movzx eax, byte [Vx]
+            put(c, {0x83, 0xe0, 0x0f});           //and eax, 0xf
+            put(c, {0x80, 0x3c, 0x06, 0x00});     //cmp byte [rsi + rax], 0
+            skipUnless(c, instr.opcode == OP_SKP ? 0x74 : 0x75, address); //je / jne
+            epilogue(c);
+        return true;
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,196 @@
+#include "Rewind.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace fish {
+
+//Frames are encoded as byte differences over the whole MachineState
+static constexpr size_t STATE_SIZE = sizeof(MachineState);
+
+//Keyframes are encoded as their difference from all zeros
+static const uint8_t ZERO_STATE[STATE_SIZE] = {};
+
+static void putVarint(std::vector<uint8_t> &out, size_t value) {
+    while(value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static size_t getVarint(const uint8_t *&in) {
+    size_t value = 0;
+    uint32_t shift = 0;
+
+    while(*in & 0x80) {
+        value |= static_cast<size_t>(*in++ & 0x7f) << shift;
+        shift += 7;
+    }
+
+    return value | (static_cast<size_t>(*in++) << shift);
+}
+
+static uint64_t loadWord(const uint8_t *data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+RewindBuffer::RewindBuffer() {
+    m_capacity = 0;
+    m_keyframe_interval = 1;
+    m_frames = 0;
+    m_bytes = 0;
+
+    //Padding bytes are compared too, so they have to start out the same
+    memset(&m_newest, 0, sizeof(m_newest));
+    memset(&m_scratch, 0, sizeof(m_scratch));
+}
+
+//Writes state XOR base as pairs of (unchanged bytes to skip, changed bytes that follow) as
+//varints, each pair followed by the XORed changed bytes
+void RewindBuffer::encode(const uint8_t *state, const uint8_t *base, std::vector<uint8_t> &out) {
+    size_t pos = 0;
+
+    while(pos < STATE_SIZE) {
+        size_t start = pos;
+
+        //Most of the state doesn't change between frames, skip it a word at a time
+        while(pos + 8 <= STATE_SIZE && loadWord(state + pos) == loadWord(base + pos)) { pos += 8; }
+        while(pos < STATE_SIZE && state[pos] == base[pos]) { pos++; }
+        size_t skipped = pos - start;
+
+        //A single unchanged byte is cheaper to keep in the changed bytes than to start a new pair for
+        start = pos;
+        while(pos < STATE_SIZE && (state[pos] != base[pos] || (pos + 1 < STATE_SIZE && state[pos + 1] != base[pos + 1]))) { pos++; }
+        size_t changed = pos - start;
+
+        putVarint(out, skipped);
+        putVarint(out, changed);
+
+        size_t end = out.size();
+        out.resize(end + changed);
+        for(size_t i = 0; i < changed; i++) {
+            out[end + i] = state[start + i] ^ base[start + i];
+        }
+    }
+}
+
+//XORs an encoded difference into state, which works in both directions
+void RewindBuffer::apply(const uint8_t *encoded, uint8_t *state) {
+    size_t pos = 0;
+
+    while(pos < STATE_SIZE) {
+        pos += getVarint(encoded);
+        size_t changed = getVarint(encoded);
+
+        for(size_t i = 0; i < changed; i++) {
+            state[pos + i] ^= encoded[i];
+        }
+
+        encoded += changed;
+        pos += changed;
+    }
+}
+
+//Rebuilds the newest frame of a group by starting at its keyframe and applying every difference after it
+void RewindBuffer::decodeLast(const RewindGroup &group, MachineState &state) {
+    uint8_t *bytes = reinterpret_cast<uint8_t*>(&state);
+    memset(bytes, 0, STATE_SIZE);
+
+    for(uint32_t offset : group.offsets) {
+        apply(group.data.data() + offset, bytes);
+    }
+}
+
+void RewindBuffer::setCapacity(uint32_t frames, uint32_t keyframe_interval) {
+    //Whole groups are dropped at once, so one can't be bigger than the buffer
+    keyframe_interval = std::max(1u, std::min(keyframe_interval, frames));
+
+    if(frames != m_capacity || keyframe_interval != m_keyframe_interval) {
+        m_capacity = frames;
+        m_keyframe_interval = keyframe_interval;
+        clear();
+    }
+}
+
+uint32_t RewindBuffer::getCapacity() const {
+    return m_capacity;
+}
+
+void RewindBuffer::clear() {
+    m_groups.clear();
+    m_frames = 0;
+    m_bytes = 0;
+}
+
+void RewindBuffer::push(const MachineState &state) {
+    if(m_capacity == 0) {
+        return;
+    }
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&state);
+    bool keyframe = m_groups.empty() || m_groups.back().offsets.size() >= m_keyframe_interval;
+
+    if(keyframe) {
+        m_groups.emplace_back();
+    }
+
+    RewindGroup &group = m_groups.back();
+    size_t before = group.data.size();
+
+    group.offsets.push_back(static_cast<uint32_t>(before));
+    encode(bytes, keyframe ? ZERO_STATE : reinterpret_cast<const uint8_t*>(&m_newest), group.data);
+    memcpy(&m_newest, bytes, STATE_SIZE);
+
+    m_bytes += group.data.size() - before;
+    m_frames++;
+
+    //Drop the oldest group, the one after it starts with a keyframe so nothing depends on it
+    while(m_frames > m_capacity) {
+        m_frames -= static_cast<uint32_t>(m_groups.front().offsets.size());
+        m_bytes -= m_groups.front().data.size();
+        m_groups.pop_front();
+    }
+}
+
+bool RewindBuffer::pop(MachineState &state) {
+    if(m_frames == 0) {
+        return false;
+    }
+
+    memcpy(&state, &m_newest, STATE_SIZE);
+
+    RewindGroup &group = m_groups.back();
+    uint32_t offset = group.offsets.back();
+    m_bytes -= group.data.size() - offset;
+    m_frames--;
+
+    if(group.offsets.size() > 1) {
+        //The newest difference takes the newest frame back to the one before it
+        apply(group.data.data() + offset, reinterpret_cast<uint8_t*>(&m_newest));
+        group.data.resize(offset);
+        group.offsets.pop_back();
+    } else {
+        //Stepping back over a keyframe, the frame before it is at the end of the previous group
+        m_groups.pop_back();
+
+        if(!m_groups.empty()) {
+            decodeLast(m_groups.back(), m_newest);
+        }
+    }
+
+    return true;
+}
+
+uint32_t RewindBuffer::getFrameCount() const {
+    return m_frames;
+}
+
+size_t RewindBuffer::getByteCount() const {
+    return m_bytes;
+}
+
+}
@@ -0,0 +1,87 @@
+#include "SaveState.hpp"
+
+#include "Log.hpp"
+
+namespace fish {
+
+std::vector<uint8_t> serializeState(const MachineState &state) {
+    std::vector<uint8_t> out;
+    out.reserve(sizeof(MachineState) + 16);
+    StateWriter writer(out);
+
+    writer.put32(STATE_MAGIC);
+    writer.put32(STATE_VERSION);
+
+    //Version 1
+    writer.putBytes(state.regs.V, CHIP8_V_REG_COUNT);
+    writer.put16(state.regs.I);
+    writer.put16(state.regs.PC);
+    writer.put8(state.regs.SP);
+    writer.put8(state.regs.DT);
+    writer.put8(state.regs.ST);
+    writer.put16(state.last_pc);
+    for(uint16_t entry : state.stack) { writer.put16(entry); }
+    writer.putBytes(state.mem, CHIP8_MEM_SIZE);
+    for(uint64_t row : state.screen) { writer.put64(row); }
+    writer.put64(state.cycles);
+    writer.put64(state.idle_cycles);
+    writer.put32(state.timer_accum);
+    writer.put8(state.waiting_for_key);
+
+    //Version 2
+    writer.put64(state.regs.RNG);
+
+    return out;
+}
+
+StatusCode deserializeState(const uint8_t *data, size_t size, MachineState &state) {
+    StateReader reader(data, size);
+
+    if(reader.get32() != STATE_MAGIC) {
+        LOG_WARN("[EMU]: Not a save state");
+        return INVALID_STATE;
+    }
+
+    uint32_t version = reader.get32();
+    if(version == 0 || version > STATE_VERSION) {
+        LOG_WARN("[EMU]: Save state version %d is not supported, the newest is %d", version, STATE_VERSION);
+        return INVALID_STATE;
+    }
+
+    //Read into a copy so a truncated file leaves state untouched
+    MachineState loaded = {};
+
+    reader.getBytes(loaded.regs.V, CHIP8_V_REG_COUNT);
+    loaded.regs.I = reader.get16();
+    loaded.regs.PC = reader.get16();
+    loaded.regs.SP = reader.get8();
+    loaded.regs.DT = reader.get8();
+    loaded.regs.ST = reader.get8();
+    loaded.last_pc = reader.get16();
+    for(uint16_t &entry : loaded.stack) { entry = reader.get16(); }
+    reader.getBytes(loaded.mem, CHIP8_MEM_SIZE);
+    for(uint64_t &row : loaded.screen) { row = reader.get64(); }
+    loaded.cycles = reader.get64();
+    loaded.idle_cycles = reader.get64();
+    loaded.timer_accum = reader.get32();
+    loaded.waiting_for_key = reader.get8() != 0;
+
+    //Older states didn't save the generator, it starts over from the default seed
+    loaded.regs.RNG = version >= 2 ? reader.get64() : seedRandom(CHIP8_DEFAULT_SEED);
+
+    if(!reader.good()) {
+        LOG_WARN("[EMU]: Save state is truncated");
+        return INVALID_STATE;
+    }
+
+    //The stack pointer indexes the stack directly
+    if(loaded.regs.SP >= CHIP8_STACK_MAX) {
+        LOG_WARN("[EMU]: Save state has an invalid stack pointer %d", loaded.regs.SP);
+        return INVALID_STATE;
+    }
+
+    state = loaded;
+    return OK;
+}
+
+}
@@ -0,0 +1,215 @@
+#include "ScreenConvert.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+//SSE2 is part of x86-64, so only AVX2 has to be checked for at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define FISH_SIMD_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define FISH_SIMD_X64 0
+#endif
+
+//GCC and Clang only allow AVX2 intrinsics in functions built for it, MSVC allows them anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define FISH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FISH_TARGET_AVX2
+#endif
+
+namespace fish {
+
+//Output rows are converted 32 pixels at a time
+static constexpr uint32_t GROUP_PIXELS = 32;
+static constexpr uint32_t MAX_GROUP_BYTES = GROUP_PIXELS * 4;
+
+//For every output byte of a group: which byte of the group's bits holds its pixel, the bit
+//within that byte, and its value for an on and an off pixel. The SIMD kernels load these as
+//vectors, so the pixel format only matters when the tables are built.
+struct GroupTables {
+    alignas(32) uint8_t index[MAX_GROUP_BYTES];
+    alignas(32) uint8_t select[MAX_GROUP_BYTES];
+    alignas(32) uint8_t on[MAX_GROUP_BYTES];
+    alignas(32) uint8_t off[MAX_GROUP_BYTES];
+    uint32_t bytes; //Output bytes per group
+    uint32_t bpp;   //Output bytes per pixel
+};
+
+typedef void (*GroupKernel)(uint32_t bits, uint8_t *out, const GroupTables &tables);
+
+uint32_t bytesPerPixel(PixelFormat format) {
+    switch(format) {
+        case PIXEL_RGB8 : return 3;
+        case PIXEL_GRAY8 : return 1;
+        default : return 4;
+    }
+}
+
+size_t convertedScreenSize(PixelFormat format, uint32_t scale, uint32_t num_rows) {
+    return static_cast<size_t>(CHIP8_SCREEN_WIDTH) * scale * num_rows * scale * bytesPerPixel(format);
+}
+
+SimdLevel detectSimdLevel() {
+#if FISH_SIMD_X64
+#if defined(_MSC_VER) && !defined(__clang__)
+    //AVX2 needs the CPU to have it and the OS to save the upper halves of the registers
+    int info[4];
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    bool avx2 = os_saves_ymm && (info[1] & (1 << 5));
+#else
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return avx2 ? SIMD_AVX2 : SIMD_SSE2;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+//The bytes a pixel of color (0xRRGGBBAA) is written as
+static void colorBytes(PixelFormat format, uint32_t color, uint8_t bytes[4]) {
+    uint8_t r = color >> 24, g = color >> 16, b = color >> 8, a = color;
+
+    switch(format) {
+        case PIXEL_GRAY8 : bytes[0] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8); break; //BT.601 luma
+        case PIXEL_RGB8 : bytes[0] = r; bytes[1] = g; bytes[2] = b; break;
+        default : bytes[0] = r; bytes[1] = g; bytes[2] = b; bytes[3] = a; break;
+    }
+}
+
+static void buildTables(PixelFormat format, uint32_t foreground, uint32_t background, GroupTables &tables) {
+    uint32_t bpp = bytesPerPixel(format);
+    uint8_t on[4], off[4];
+
+    colorBytes(format, foreground, on);
+    colorBytes(format, background, off);
+    tables.bytes = GROUP_PIXELS * bpp;
+    tables.bpp = bpp;
+
+    for(uint32_t k = 0; k < tables.bytes; k++) {
+        uint32_t pixel = k / bpp;
+        tables.index[k] = pixel / 8;
+        tables.select[k] = 0x80 >> (pixel % 8);
+        tables.on[k] = on[k % bpp];
+        tables.off[k] = off[k % bpp];
+    }
+}
+
+//The 32 pixels of a row scaled up by scale that start at output pixel first, as bits with the
+//leftmost pixel in the most significant bit
+static uint32_t scaledBits(uint64_t row, uint32_t scale, uint32_t first) {
+    if(scale == 1) {
+        return static_cast<uint32_t>(row >> (CHIP8_SCREEN_WIDTH - GROUP_PIXELS - first));
+    }
+
+    //Each source pixel adds up to scale copies of its bit at once
+    uint32_t x = first / scale;
+    uint32_t copies = scale - first % scale;
+    uint32_t left = GROUP_PIXELS;
+    uint64_t bits = 0;
+
+    while(left > 0) {
+        uint32_t n = std::min(copies, left);
+        uint64_t pixel = (row >> (CHIP8_SCREEN_WIDTH - 1 - x)) & 1;
+
+        bits = (bits << n) | ((0 - pixel) & ((1ull << n) - 1));
+        left -= n;
+        copies = scale;
+        x++;
+    }
+
+    return static_cast<uint32_t>(bits);
+}
+
+//Instantiated per pixel size so every copy is a single fixed size store
+template<uint32_t BPP>
+static void expandScalar(uint32_t bits, uint8_t *out, const GroupTables &tables) {
+    for(uint32_t i = 0; i < GROUP_PIXELS; i++) {
+        //The first BPP bytes of the tables are one whole pixel
+        memcpy(out, (bits >> (GROUP_PIXELS - 1 - i)) & 1 ? tables.on : tables.off, BPP);
+        out += BPP;
+    }
+}
+
+#if FISH_SIMD_X64
+//16 pixels per half, SSE2 has no byte shuffle so each byte of the mask picks between the
+//two bytes of bits with an AND/ANDNOT/OR instead
+static void expandSse2(uint32_t bits, uint8_t *out, const GroupTables &tables) {
+    uint32_t half_bytes = tables.bytes / 2;
+
+    for(uint32_t half = 0; half < 2; half++) {
+        __m128i first = _mm_set1_epi8(static_cast<char>(bits >> (24 - half * 16)));
+        __m128i second = _mm_set1_epi8(static_cast<char>(bits >> (16 - half * 16)));
+
+        for(uint32_t k = 0; k < half_bytes; k += 16) {
+            __m128i in_second = _mm_cmpeq_epi8(_mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(&tables.index[k])), _mm_set1_epi8(1)), _mm_set1_epi8(1));
+            __m128i select = _mm_load_si128(reinterpret_cast<const __m128i*>(&tables.select[k]));
+            __m128i source = _mm_or_si128(_mm_and_si128(in_second, second), _mm_andnot_si128(in_second, first));
+            __m128i mask = _mm_cmpeq_epi8(_mm_and_si128(source, select), select);
+            __m128i on = _mm_load_si128(reinterpret_cast<const __m128i*>(&tables.on[k]));
+            __m128i off = _mm_load_si128(reinterpret_cast<const __m128i*>(&tables.off[k]));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[half * half_bytes + k]), _mm_or_si128(_mm_and_si128(mask, on), _mm_andnot_si128(mask, off)));
+        }
+    }
+}
+
+//All 32 pixels at once, the four bytes of bits are in every 128-bit lane so one in-lane
+//shuffle gives every output byte the byte holding its pixel
+FISH_TARGET_AVX2 static void expandAvx2(uint32_t bits, uint8_t *out, const GroupTables &tables) {
+    __m256i word = _mm256_set1_epi32(static_cast<int>((bits >> 24) | ((bits >> 8) & 0xff00) | ((bits << 8) & 0xff0000) | (bits << 24)));
+
+    for(uint32_t k = 0; k < tables.bytes; k += 32) {
+        __m256i index = _mm256_load_si256(reinterpret_cast<const __m256i*>(&tables.index[k]));
+        __m256i select = _mm256_load_si256(reinterpret_cast<const __m256i*>(&tables.select[k]));
+        __m256i mask = _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(word, index), select), select);
+        __m256i on = _mm256_load_si256(reinterpret_cast<const __m256i*>(&tables.on[k]));
+        __m256i off = _mm256_load_si256(reinterpret_cast<const __m256i*>(&tables.off[k]));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[k]), _mm256_blendv_epi8(off, on, mask));
+    }
+}
+#endif
+
+void convertScreen(const uint64_t *rows, uint32_t num_rows, uint8_t *out, PixelFormat format, uint32_t scale, uint32_t foreground, uint32_t background) {
+    static const SimdLevel level = detectSimdLevel();
+    convertScreen(rows, num_rows, out, format, scale, foreground, background, level);
+}
+
+void convertScreen(const uint64_t *rows, uint32_t num_rows, uint8_t *out, PixelFormat format, uint32_t scale, uint32_t foreground, uint32_t background, SimdLevel level) {
+    if(scale == 0) {
+        return;
+    }
+
+    GroupTables tables;
+    buildTables(format, foreground, background, tables);
+
+    GroupKernel kernel = tables.bpp == 4 ? expandScalar<4> : tables.bpp == 3 ? expandScalar<3> : expandScalar<1>;
+#if FISH_SIMD_X64
+    if(level == SIMD_AVX2) { kernel = expandAvx2; }
+    else if(level == SIMD_SSE2) { kernel = expandSse2; }
+#endif
+
+    uint32_t groups = CHIP8_SCREEN_WIDTH * scale / GROUP_PIXELS;
+    size_t pitch = static_cast<size_t>(groups) * tables.bytes;
+
+    for(uint32_t y = 0; y < num_rows; y++) {
+        uint8_t *line = out + y * scale * pitch;
+
+        for(uint32_t g = 0; g < groups; g++) {
+            kernel(scaledBits(rows[y], scale, g * GROUP_PIXELS), line + g * tables.bytes, tables);
+        }
+
+        //Scaling up vertically is just repeating the line
+        for(uint32_t i = 1; i < scale; i++) {
+            memcpy(line + i * pitch, line, pitch);
+        }
+    }
+}
+
+}
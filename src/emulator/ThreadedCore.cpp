@@ -0,0 +1,393 @@
+#include "Chip8.hpp"
+#include "Quirks.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+//GCC and Clang support taking the address of labels, which lets every instruction jump
+//straight to the next one's code. Other compilers get a plain switch in a loop instead.
+#if defined(__GNUC__) || defined(__clang__)
+#define FISH_COMPUTED_GOTO 1
+#else
+#define FISH_COMPUTED_GOTO 0
+#endif
+
+namespace fish {
+
+//Same semantics as the functions in Instruction.cpp, but with the whole machine state
+//kept in locals for the entire batch so the compiler can keep it in registers instead
+//of going through a Registers reference and five pointers for every instruction.
+//Instantiated once per quirk profile Q, so quirks are settled at compile time.
+template<typename Q>
+uint32_t Chip8::runThreaded(uint32_t num, const bool *keys) {
+    uint8_t V[CHIP8_V_REG_COUNT];
+    uint16_t pc, I, last_pc;
+    uint8_t sp, dt, st;
+    uint32_t timer_accum;
+
+//Moves the machine state between the members and the locals
+#define LOAD_STATE()                                            \
+    memcpy(V, m_regs.V, CHIP8_V_REG_COUNT);                     \
+    pc = m_regs.PC;                                             \
+    I  = m_regs.I;                                              \
+    sp = m_regs.SP;                                             \
+    dt = m_regs.DT;                                             \
+    st = m_regs.ST;                                             \
+    last_pc = m_last_pc;                                        \
+    timer_accum = m_timer_accum;
+
+#define STORE_STATE()                                           \
+    memcpy(m_regs.V, V, CHIP8_V_REG_COUNT);                     \
+    m_regs.PC = pc;                                             \
+    m_regs.I  = I;                                              \
+    m_regs.SP = sp;                                             \
+    m_regs.DT = dt;                                             \
+    m_regs.ST = st;                                             \
+    m_last_pc = last_pc;                                        \
+    m_timer_accum = timer_accum;
+
+    LOAD_STATE();
+
+    const uint32_t timer_step = m_timer_step;
+    const uint32_t clock_rate = m_clock_rate;
+
+    uint8_t *const mem = m_mem;
+    uint64_t *const screen = m_screen;
+    uint16_t *const stack = m_stack;
+
+    uint32_t remaining = num;
+    const DecodedInstruction *instr = nullptr;
+
+//Fetches the next instruction or leaves once the batch is done
+#define FETCH()                                                 \
+    if(remaining == 0) { goto done; }                           \
+    pc &= CHIP8_MEM_SIZE - 1;                                   \
+    last_pc = pc;                                               \
+    instr = &m_interpreter.fetch(mem, pc);
+
+//Moves past the instruction that was just executed and ticks the timers
+#define RETIRE()                                                \
+    pc += 2;                                                    \
+    remaining--;                                                \
+    timer_accum += timer_step;                                  \
+    while(timer_accum >= clock_rate) {                          \
+        timer_accum -= clock_rate;                              \
+        dt -= dt > 0 ? 1 : 0;                                   \
+        st -= st > 0 ? 1 : 0;                                   \
+    }
+
+#if FISH_COMPUTED_GOTO
+    //Must be in the same order as the Opcode enum
+    static const void *const labels[OP_COUNT] = {
+        &&L_NOP,    &&L_CLS,    &&L_RET,    &&L_JP_1,
+        &&L_CALL,   &&L_SE_3,   &&L_SNE_4,  &&L_SE_5,
+        &&L_LD_6,   &&L_ADD_7,  &&L_LD_8,   &&L_OR,
+        &&L_AND,    &&L_XOR,    &&L_ADD_8,  &&L_SUB,
+        &&L_SHR,    &&L_SUBN,   &&L_SHL,    &&L_SNE_9,
+        &&L_LD_A,   &&L_JP_B,   &&L_RND,    &&L_DRW,
+        &&L_SKP,    &&L_SKNP,   &&L_LD_F07, &&L_LD_F0A,
+        &&L_LD_F15, &&L_LD_F18, &&L_ADD_F,  &&L_LD_F29,
+        &&L_LD_F33, &&L_LD_F55, &&L_LD_F65
+    };
+
+#define CASE(name) L_##name
+#define DISPATCH() FETCH(); goto *labels[instr->opcode];
+#define NEXT() RETIRE(); DISPATCH();
+#define RESUME() DISPATCH();
+
+    DISPATCH();
+#else
+#define CASE(name) case OP_##name
+#define NEXT() RETIRE(); continue;
+#define RESUME() continue;
+
+    for(;;) {
+    FETCH();
+    switch(instr->opcode) {
+#endif
+
+    CASE(NOP): {
+        NEXT();
+    }
+
+    CASE(CLS): {
+        memset(screen, 0, CHIP8_SCREEN_HEIGHT * sizeof(uint64_t));
+        m_dirty_rows = ~0u;
+        NEXT();
+    }
+
+    CASE(RET): {
+        pc = stack[sp];
+        sp -= sp > 0 ? 1 : 0;
+        NEXT();
+    }
+
+    CASE(JP_1): {
+        pc = instr->nnn - 2;
+        RETIRE();
+
+        //A jump backwards could have landed at the start of a loop that only waits
+        if(pc <= last_pc && remaining > 0) {
+            STORE_STATE();
+            remaining -= skipIdleLoop(remaining, keys);
+            LOAD_STATE();
+        }
+
+        RESUME();
+    }
+
+    CASE(CALL): {
+        sp += 1;
+        stack[sp] = pc;
+        pc = instr->nnn - 2;
+        NEXT();
+    }
+
+    CASE(SE_3): {
+        if(V[instr->x] == instr->nn) pc += 2;
+        NEXT();
+    }
+
+    CASE(SNE_4): {
+        if(V[instr->x] != instr->nn) pc += 2;
+        NEXT();
+    }
+
+    CASE(SE_5): {
+        if(V[instr->x] == V[instr->y]) pc += 2;
+        NEXT();
+    }
+
+    CASE(LD_6): {
+        V[instr->x] = instr->nn;
+        NEXT();
+    }
+
+    CASE(ADD_7): {
+        V[instr->x] += instr->nn;
+        NEXT();
+    }
+
+    CASE(LD_8): {
+        V[instr->x] = V[instr->y];
+        NEXT();
+    }
+
+    CASE(OR): {
+        V[instr->x] |= V[instr->y];
+        if constexpr(Q::reset_vf) { V[0xf] = 0; }
+        NEXT();
+    }
+
+    CASE(AND): {
+        V[instr->x] &= V[instr->y];
+        if constexpr(Q::reset_vf) { V[0xf] = 0; }
+        NEXT();
+    }
+
+    CASE(XOR): {
+        V[instr->x] ^= V[instr->y];
+        if constexpr(Q::reset_vf) { V[0xf] = 0; }
+        NEXT();
+    }
+
+    CASE(ADD_8): {
+        uint16_t sum = V[instr->x] + V[instr->y];
+        V[0xf] = sum > 255;
+        V[instr->x] = sum & 0xff;
+        NEXT();
+    }
+
+    CASE(SUB): {
+        uint8_t dif = V[instr->x] - V[instr->y];
+        V[0xf] = V[instr->x] > V[instr->y];
+        V[instr->x] = dif;
+        NEXT();
+    }
+
+    CASE(SHR): {
+        if constexpr(Q::shift_vy) {
+            uint8_t value = V[instr->y];
+            V[instr->x] = value >> 1;
+            V[0xf] = value & 0x1;
+        } else {
+            V[0xf] = V[instr->x] & 0x1;
+            V[instr->x] = V[instr->x] >> 1;
+        }
+        NEXT();
+    }
+
+    CASE(SUBN): {
+        V[0xf] = V[instr->y] <= V[instr->x];
+        V[instr->x] = V[instr->y] - V[instr->x];
+        NEXT();
+    }
+
+    CASE(SHL): {
+        if constexpr(Q::shift_vy) {
+            uint8_t value = V[instr->y];
+            V[instr->x] = value << 1;
+            V[0xf] = value >> 7;
+        } else {
+            V[0xf] = V[instr->x] >> 7;
+            V[instr->x] = V[instr->x] << 1;
+        }
+        NEXT();
+    }
+
+    CASE(SNE_9): {
+        if(V[instr->x] != V[instr->y]) pc += 2;
+        NEXT();
+    }
+
+    CASE(LD_A): {
+        I = instr->nnn;
+        NEXT();
+    }
+
+    CASE(JP_B): {
+        pc = (instr->nnn + V[Q::jump_vx ? instr->x : 0]) - 2;
+        NEXT();
+    }
+
+    CASE(RND): {
+        V[instr->x] = static_cast<uint8_t>(nextRandom(m_regs.RNG) >> 24) & instr->nn;
+        NEXT();
+    }
+
+    CASE(DRW): {
+        uint8_t vx = V[instr->x];
+        uint8_t vy = V[instr->y];
+        uint64_t collision = 0;
+
+        m_dirty_rows |= spriteRows(vy, instr->n, Q::clip);
+
+        for(int i = 0; i < instr->n; i++) {
+            uint64_t sprite_row;
+            uint32_t row;
+
+            if constexpr(Q::clip) {
+                row = (vy & (CHIP8_SCREEN_HEIGHT - 1)) + i;
+                if(row >= CHIP8_SCREEN_HEIGHT) { break; }
+                sprite_row = clipSpriteRow(mem[wrapAddress(I + i)], vx);
+            } else {
+                row = (vy + i) & (CHIP8_SCREEN_HEIGHT - 1);
+                sprite_row = placeSpriteRow(mem[wrapAddress(I + i)], vx);
+            }
+
+            uint64_t &screen_row = screen[row];
+            collision |= screen_row & sprite_row;
+            screen_row ^= sprite_row;
+        }
+
+        V[0xf] = collision != 0;
+        NEXT();
+    }
+
+    CASE(SKP): {
+        pc += keys[V[instr->x] & 0xf] ? 2 : 0;
+        NEXT();
+    }
+
+    CASE(SKNP): {
+        pc += !keys[V[instr->x] & 0xf] ? 2 : 0;
+        NEXT();
+    }
+
+    CASE(LD_F07): {
+        V[instr->x] = dt;
+        NEXT();
+    }
+
+    CASE(LD_F0A): {
+        //Same linear key array to keypad mapping as LD_F0A in Instruction.cpp
+        static const uint8_t keypad[CHIP8_NUM_KEYS] = {0x1, 0x2, 0x3, 0xc, 0x4, 0x5, 0x6, 0xd, 0x7, 0x8, 0x9, 0xe, 0xa, 0x0, 0xb, 0xf};
+        bool pressed = false;
+
+        for(uint32_t k = 0; k < CHIP8_NUM_KEYS; k++) {
+            if(keys[k]) { V[instr->x] = keypad[k]; pressed = true; break; }
+        }
+
+        //Stay on this instruction and stop until a key is pressed
+        if(!pressed) {
+            pc -= 2;
+            RETIRE();
+            m_waiting_for_key = true;
+            goto done;
+        }
+
+        NEXT();
+    }
+
+    CASE(LD_F15): {
+        dt = V[instr->x];
+        NEXT();
+    }
+
+    CASE(LD_F18): {
+        st = V[instr->x];
+        NEXT();
+    }
+
+    CASE(ADD_F): {
+        I += V[instr->x];
+        NEXT();
+    }
+
+    CASE(LD_F29): {
+        I = V[instr->x] * 5;
+        NEXT();
+    }
+
+    CASE(LD_F33): {
+        uint8_t value = V[instr->x];
+        mem[wrapAddress(I)] = value / 100;
+        mem[wrapAddress(I + 1)] = (value / 10) % 10;
+        mem[wrapAddress(I + 2)] = value % 10;
+        invalidateCode(I, 3);
+        NEXT();
+    }
+
+    CASE(LD_F55): {
+        uint8_t x = instr->x;
+        for(uint32_t i = 0; i <= x; i++) { mem[wrapAddress(I + i)] = V[i]; }
+        invalidateCode(I, x + 1);
+        I += Q::indexStep(x);
+        NEXT();
+    }
+
+    CASE(LD_F65): {
+        for(uint32_t i = 0; i <= instr->x; i++) { V[i] = mem[wrapAddress(I + i)]; }
+        I += Q::indexStep(instr->x);
+        NEXT();
+    }
+
+#if !FISH_COMPUTED_GOTO
+    default: {
+        NEXT();
+    }
+    }
+    }
+#endif
+
+done:
+    STORE_STATE();
+
+#undef LOAD_STATE
+#undef STORE_STATE
+#undef FETCH
+#undef RETIRE
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+#undef RESUME
+
+    return num - remaining;
+}
+
+template uint32_t Chip8::runThreaded<ModernQuirks>(uint32_t num, const bool *keys);
+template uint32_t Chip8::runThreaded<CosmacVipQuirks>(uint32_t num, const bool *keys);
+template uint32_t Chip8::runThreaded<Chip48Quirks>(uint32_t num, const bool *keys);
+template uint32_t Chip8::runThreaded<SchipQuirks>(uint32_t num, const bool *keys);
+
+}
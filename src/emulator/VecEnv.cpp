@@ -0,0 +1,184 @@
+#include "VecEnv.hpp"
+
+#include <cstring>
+
+#include "Log.hpp"
+
+namespace fish {
+
+VecEnv::VecEnv(uint32_t size, const EnvConfig &config) : m_config(config), m_core(size) {
+    m_config.frame_skip = m_config.frame_skip > 0 ? m_config.frame_skip : 1;
+    m_config.obs_scale = m_config.obs_scale > 0 ? m_config.obs_scale : 1;
+
+    //Lockstep means every environment runs the same number of instructions each frame, so the
+    //fraction can't be carried per environment without episodes depending on when they started
+    m_frame_cycles = (m_config.clock_rate + CHIP8_TIMER_FREQ / 2) / CHIP8_TIMER_FREQ;
+    m_frame_cycles = m_frame_cycles > 0 ? m_frame_cycles : 1;
+    m_obs_size = convertedScreenSize(m_config.obs_format, m_config.obs_scale);
+
+    m_core.setClockRate(m_config.clock_rate);
+    m_core.setQuirkProfile(m_config.quirks);
+
+    memset(&m_boot, 0, sizeof(m_boot));
+    memset(&m_scratch, 0, sizeof(m_scratch));
+    m_loaded = false;
+
+    m_rng.assign(size, 0);
+    m_keys.assign(size, 0);
+    m_frames.assign(size, 0);
+    m_values.assign(static_cast<size_t>(size) * m_config.rewards.size(), 0);
+    m_finished.assign(size, 0);
+}
+
+VecEnv::~VecEnv() { }
+
+StatusCode VecEnv::loadRom(const std::string &path) {
+    //Boot on a Chip8 set up to behave exactly like a BatchCore machine
+    Chip8 boot;
+    boot.setDeterministic(true);
+    boot.setIdleSkipping(false);
+    boot.setClockRate(m_config.clock_rate);
+    boot.setQuirkProfile(m_config.quirks);
+
+    StatusCode status = boot.loadRom(path);
+    if(status != OK) {
+        return status;
+    }
+
+    const bool keys[CHIP8_NUM_KEYS] = {};
+    for(uint32_t i = 0; i < m_config.boot_frames; i++) {
+        boot.cycle(m_frame_cycles, keys);
+    }
+
+    boot.saveState(m_boot);
+    m_loaded = true;
+
+    return OK;
+}
+
+uint32_t VecEnv::getSize() const {
+    return m_core.getSize();
+}
+
+size_t VecEnv::getObservationSize() const {
+    return m_obs_size;
+}
+
+const EnvConfig& VecEnv::getConfig() const {
+    return m_config;
+}
+
+uint32_t VecEnv::getEpisodeFrame(uint32_t index) const {
+    return m_frames[index];
+}
+
+void VecEnv::resetEnv(uint32_t index, uint64_t seed) {
+    m_scratch = m_boot;
+    m_scratch.regs.RNG = seedRandom(seed);
+    m_core.loadState(index, m_scratch);
+
+    m_keys[index] = 0;
+    m_frames[index] = 0;
+
+    const size_t count = m_config.rewards.size();
+    for(size_t r = 0; r < count; r++) {
+        m_values[index * count + r] = readReward(index, m_config.rewards[r]);
+    }
+}
+
+int64_t VecEnv::readReward(uint32_t index, const RewardAddress &reward) const {
+    switch(reward.encoding) {
+        case REWARD_BYTE : return m_core.readMemory(index, reward.address);
+        case REWARD_WORD : return (m_core.readMemory(index, reward.address) << 8) | m_core.readMemory(index, reward.address + 1);
+
+        case REWARD_DIGITS : {
+            int64_t value = 0;
+            for(uint32_t i = 0; i < reward.digits; i++) {
+                value = value * 10 + m_core.readMemory(index, reward.address + i);
+            }
+
+            return value;
+        }
+    }
+
+    return 0;
+}
+
+bool VecEnv::isDone(uint32_t index) const {
+    for(const DoneCondition &done : m_config.dones) {
+        if((m_core.readMemory(index, done.address) & done.mask) == done.value) {
+            return true;
+        }
+    }
+
+    return m_config.max_frames > 0 && m_frames[index] >= m_config.max_frames;
+}
+
+void VecEnv::writeObservation(uint32_t index, uint8_t *observations) const {
+    convertScreen(m_core.getScreenRows(index), CHIP8_SCREEN_HEIGHT, observations + index * m_obs_size,
+                  m_config.obs_format, m_config.obs_scale, m_config.foreground, m_config.background);
+}
+
+void VecEnv::reset(const uint64_t *seeds, uint8_t *observations) {
+    if(!m_loaded) {
+        LOG_WARN("[ENV]: Reset before a ROM was loaded, environments start blank");
+    }
+
+    for(uint32_t i = 0; i < getSize(); i++) {
+        //The machine gets the seed as is, sticky actions and later episodes draw from a stream derived from it
+        m_rng[i] = seedRandom(~seeds[i]);
+        resetEnv(i, seeds[i]);
+        writeObservation(i, observations);
+    }
+}
+
+void VecEnv::step(const uint16_t *actions, uint8_t *observations, float *rewards, uint8_t *dones) {
+    const uint32_t size = getSize();
+    const size_t count = m_config.rewards.size();
+
+    for(uint32_t i = 0; i < size; i++) {
+        rewards[i] = 0;
+        m_finished[i] = 0;
+    }
+
+    for(uint32_t frame = 0; frame < m_config.frame_skip; frame++) {
+        for(uint32_t i = 0; i < size; i++) {
+            if(m_finished[i]) { continue; }
+
+            //The top 24 bits of a draw give an evenly spread float in [0, 1)
+            bool sticky = m_config.sticky_actions > 0 && (nextRandom(m_rng[i]) >> 8) * (1.0f / 16777216.0f) < m_config.sticky_actions;
+            if(!sticky) {
+                m_keys[i] = actions[i];
+            }
+        }
+
+        //Finished machines run on with the rest, whatever they do is thrown away by the reset
+        m_core.cycle(m_frame_cycles, m_keys.data());
+
+        for(uint32_t i = 0; i < size; i++) {
+            if(m_finished[i]) { continue; }
+
+            m_frames[i]++;
+
+            for(size_t r = 0; r < count; r++) {
+                int64_t value = readReward(i, m_config.rewards[r]);
+                rewards[i] += static_cast<float>(value - m_values[i * count + r]) * m_config.rewards[r].scale;
+                m_values[i * count + r] = value;
+            }
+
+            m_finished[i] = isDone(i);
+        }
+    }
+
+    for(uint32_t i = 0; i < size; i++) {
+        if(m_finished[i]) {
+            uint64_t seed = (static_cast<uint64_t>(nextRandom(m_rng[i])) << 32) | nextRandom(m_rng[i]);
+            resetEnv(i, seed);
+        }
+
+        dones[i] = m_finished[i];
+        writeObservation(i, observations);
+    }
+}
+
+}
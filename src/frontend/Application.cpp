@@ -1,5 +1,7 @@
 #include "Application.hpp"
 
+#include <algorithm>
+
 #include <tinyfiledialogs.h>
 #define MA_NO_DECODING
 #define MA_NO_ENCODING
@@ -7,8 +9,14 @@
 #include <miniaudio.h>
 
 #include "Log.hpp"
+#include "ScreenConvert.hpp"
 
-Application::Application() { }
+Application::Application() {
+    m_running_last = false;
+    m_texture_frame = 0;
+    m_rewind_held = false;
+    m_fast_forward_held = false;
+}
 
 Application::~Application() {   
     cleanup();
@@ -34,13 +42,14 @@ bool Application::init(int width, int height, const std::string &title, int argc
     //Initialize ImGui
     if(!m_gui.init(m_window.getWindow(), m_settings)) { return false; LOG_ERROR("[APP]: ImGui Failed to Initialize!"); }
 
-    //Attach the emulator to the Debugger
-    m_debug.attach(m_emu);
+    //Start the emulation thread, it sits idle until a ROM is loaded and started
+    m_emu.configure(m_settings);
+    m_emu.start();
     m_settings.new_rom_callback = newRomCallback;
 
     //Load ROM if one was specified
     if(!m_rom_path.empty()) { 
-        if(m_settings.new_rom_callback(m_window.getWindow(), m_rom_path.c_str(), m_emu)) {
+        if(m_settings.new_rom_callback(m_window.getWindow(), m_rom_path.c_str())) {
             m_settings.run_chip8 = true;
             m_settings.status = "Running";
         }
@@ -84,11 +93,17 @@ bool Application::initOpengl() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+    //One byte per pixel, 0 for off and 255 for on, the colors come from the palette in the shader.
+    //Allocated once, updateTexture only replaces the rows that changed.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, fish::CHIP8_SCREEN_WIDTH, fish::CHIP8_SCREEN_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+
     //Create and Bind Shaders
     const char *vertex_shader = "#version 150\nuniform float dist; uniform vec2 ratio; in vec2 pos; out vec2 texCoord; void main() { "
                                 "texCoord = (pos * vec2(1, -1) + 1) / 2; float new_y = pos.y == 1.0f ? pos.y - dist : pos.y;"
                                 "gl_Position = vec4(pos.x * ratio.x, new_y * ratio.y, 0.0, 1.0); }";
-    const char *fragment_shader = "#version 150\nout vec4 outColor; in vec2 texCoord; uniform sampler2D tex; void main() { outColor = texture(tex, texCoord); }";
+    const char *fragment_shader = "#version 150\nout vec4 outColor; in vec2 texCoord; uniform sampler2D tex; uniform vec3 foreground; uniform vec3 background;"
+                                  "void main() { outColor = vec4(mix(background, foreground, texture(tex, texCoord).r), 1.0); }";
 
     //Vertex Shader
     GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -138,6 +153,9 @@ bool Application::initOpengl() {
     //Get Uniform Locations
     m_uniform_dist = glGetUniformLocation(program, "dist");
     m_uniform_ratio = glGetUniformLocation(program, "ratio");
+    m_uniform_foreground = glGetUniformLocation(program, "foreground");
+    m_uniform_background = glGetUniformLocation(program, "background");
+    updatePalette();
 
     //Set clear color to black
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -194,35 +212,30 @@ void Application::loop() {
     //Call the resize callback once so certain graphics values can be set
     resizeCallback(m_window.getWindow(), m_window.getInitWidth(), m_window.getInitHeight());
 
-    //Used for timing the emulator cycles
-    double this_time = glfwGetTime();
-    double last_time = this_time;
-    double delta = 0, error = 0;
-
     //Start audio device
     ma_device_start(&m_device);
 
     //Close Application when the window is closed
     while(!m_window.requestClose()) {
-        //Poll glfw for events and check for key presses
-        glfwPollEvents();
+        //Poll glfw for events and check for key presses, while the emulator is waiting for a key
+        //and nothing else is going on there's no need to spin until one arrives
+        const fish::DebugSnapshot &state = m_emu.getFrame().state;
+        if(state.waiting_for_key && !state.play_sound) {
+            glfwWaitEventsTimeout(1.0 / fish::CHIP8_TIMER_FREQ);
+        } else {
+            glfwPollEvents();
+        }
         updateKeys();
 
-        //Timing
-        this_time = glfwGetTime();
-        delta = this_time - last_time;
-        last_time = this_time;
-
-        //Update emulator and screen texture
-        updateEmulator(delta, error);
-        updateTexture();
+        //Hand settings to the emulator and pick up the newest frame it finished
+        updateEmulator();
+        if(m_emu.consumeFrame()) {
+            updateTexture();
+        }
+        updatePalette();
 
         //Run audio if required
-        if(m_emu.shouldPlaySound()) {
-            ma_waveform_set_frequency(&m_sine_wave, m_settings.audio_freq);
-        } else {
-            ma_waveform_set_frequency(&m_sine_wave, 0.0);
-        }
+        updateAudio();
 
         //Start a new frame for ImGui
         if(m_settings.show_gui) {
@@ -236,9 +249,9 @@ void Application::loop() {
         //Update ImGui and then Render
         if(m_settings.show_gui) {
             if(m_settings.use_debug) {
-                m_gui.updateWithDebug(m_settings, m_emu, m_emu_keys, m_window.getWindow(), m_debug);
+                m_gui.updateWithDebug(m_settings, m_emu, m_window.getWindow(), m_debug);
             } else {
-                m_gui.update(m_settings, m_emu, m_emu_keys, m_window.getWindow());
+                m_gui.update(m_settings, m_emu, m_window.getWindow());
             }
 
             m_gui.render();
@@ -250,8 +263,8 @@ void Application::loop() {
 }
 
 void Application::cleanup() {
-    //Detach the emulator from the debugger
-    m_debug.detach();
+    //Stop the emulation thread before anything it could be using goes away
+    m_emu.stop();
 
     //Uninit the audio device
     ma_device_uninit(&m_device);
@@ -263,41 +276,76 @@ void Application::cleanup() {
     m_window.destroy();
 }
 
-void Application::updateEmulator(double delta, double error) {
-    if(m_settings.run_chip8) {
-        double num_cycles = m_settings.run_speed * delta; //cycles / sec * sec / frame = cycles / frame
-        
-        //Accumulate and check error
-        error += num_cycles - std::floor(num_cycles);
-        if(error >= 1.0) { num_cycles += 1.0; error = error - std::floor(error); }
-
-        //Check for loop
-        if(m_settings.detect_loop && m_emu.detectLoop()) {
-            m_settings.run_chip8 = false;
-            m_settings.status = "Halted (loop detected)";
-        }
+void Application::updateEmulator() {
+    //The emulation thread halts itself when it finds a loop
+    if(m_emu.takeLoopDetected()) {
+        m_settings.run_chip8 = false;
+        m_settings.status = "Halted (loop detected)";
+    }
 
-        //Cycle Emulator
-        m_emu.cycle(static_cast<uint32_t>(num_cycles), m_emu_keys, m_settings.stop_timers && !m_running_last);
+    //Only hand over changes, so a halt from the thread isn't undone before it is seen here
+    if(m_settings.run_chip8 != m_running_last) {
+        m_emu.setRunning(m_settings.run_chip8);
+        m_running_last = m_settings.run_chip8;
+    }
 
-        m_running_last = true;
-    } else {
-        m_running_last = false;
+    m_emu.configure(m_settings);
+    m_emu.setKeys(m_emu_keys);
+    m_emu.setRewinding(m_rewind_held && m_settings.rewind_length > 0);
+    m_emu.setFastForward(m_settings.fast_forward || m_fast_forward_held);
+}
+
+void Application::updateAudio() {
+    const EmulatorFrame &frame = m_emu.getFrame();
+    double frequency = frame.state.play_sound ? m_settings.audio_freq : 0.0;
+
+    //Fast forwarding either mutes the beep or raises it by how much faster than normal the machine runs
+    if(m_emu.isFastForwarding() && frequency > 0) {
+        if(m_settings.fast_forward_mute) {
+            frequency = 0.0;
+        } else if(m_settings.run_speed > 0) {
+            frequency = std::min(frequency * std::max(1.0, frame.achieved_rate / m_settings.run_speed), 20000.0);
+        }
     }
+
+    ma_waveform_set_frequency(&m_sine_wave, frequency);
 }
 
 void Application::updateTexture() {
-    uint32_t texture[fish::CHIP8_SCREEN_PIXELS];
-    
-    //If the pixel is zero set it to the off color, if not it is set to the on color
+    const EmulatorFrame &frame = m_emu.getFrame();
+
+    //Only rows that changed since the frame the texture was last updated from are converted and uploaded
+    uint32_t dirty = 0;
+
     for(uint32_t y = 0; y < fish::CHIP8_SCREEN_HEIGHT; y++) {
-        for(uint32_t x = 0; x < fish::CHIP8_SCREEN_WIDTH; x++) {
-            texture[x + y * fish::CHIP8_SCREEN_WIDTH] = m_emu.getScreenPixel(x, y) > 0 ? floatsToUint(m_settings.foreground) : floatsToUint(m_settings.background);
-        }
+        if(frame.row_frames[y] > m_texture_frame) { dirty |= 1u << y; }
+    }
+
+    m_texture_frame = frame.number;
+
+    if(dirty == 0) {
+        return;
+    }
+
+    uint8_t texture[fish::CHIP8_SCREEN_PIXELS];
+    uint32_t y = 0;
+
+    while(y < fish::CHIP8_SCREEN_HEIGHT) {
+        if(!((dirty >> y) & 1)) { y++; continue; }
+
+        //Convert and upload each run of dirty rows at once, white and black in grayscale are 255 and 0
+        uint32_t first = y;
+        while(y < fish::CHIP8_SCREEN_HEIGHT && ((dirty >> y) & 1)) { y++; }
+
+        fish::convertScreen(&frame.state.screen[first], y - first, &texture[first * fish::CHIP8_SCREEN_WIDTH], fish::PIXEL_GRAY8, 1, 0xffffffff, 0x000000ff);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, fish::CHIP8_SCREEN_WIDTH, y - first, GL_RED, GL_UNSIGNED_BYTE, &texture[first * fish::CHIP8_SCREEN_WIDTH]);
     }
+}
 
-    //Set the texture data
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, fish::CHIP8_SCREEN_WIDTH, fish::CHIP8_SCREEN_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, texture);
+void Application::updatePalette() {
+    //The shader picks between the two colors, so changing them never touches the texture
+    glUniform3fv(m_uniform_foreground, 1, m_settings.foreground);
+    glUniform3fv(m_uniform_background, 1, m_settings.background);
 }
 
 void Application::updateKeys() {
@@ -305,6 +353,10 @@ void Application::updateKeys() {
     for(uint32_t i = 0; i < fish::CHIP8_NUM_KEYS; i++) {
         m_emu_keys[i] = glfwGetKey(m_window.getWindow(), m_settings.key_map[i]) == GLFW_PRESS;
     }
+
+    m_rewind_held = glfwGetKey(m_window.getWindow(), GLFW_KEY_BACKSPACE) == GLFW_PRESS;
+    //Tab also moves focus between ImGui widgets, it only fast forwards when ImGui isn't taking the keyboard
+    m_fast_forward_held = glfwGetKey(m_window.getWindow(), GLFW_KEY_TAB) == GLFW_PRESS && !ImGui::GetIO().WantCaptureKeyboard;
 }
 
 void Application::updateUniforms(int width, int height) {
@@ -361,9 +413,9 @@ void Application::resizeCallback(GLFWwindow *window, int width, int height) {
 
     if(app->m_settings.show_gui) {
         if(app->m_settings.use_debug) {
-            app->m_gui.updateWithDebug(app->m_settings, app->m_emu, app->m_emu_keys, window, app->m_debug);
+            app->m_gui.updateWithDebug(app->m_settings, app->m_emu, window, app->m_debug);
         } else {
-            app->m_gui.update(app->m_settings, app->m_emu, app->m_emu_keys, window);
+            app->m_gui.update(app->m_settings, app->m_emu, window);
         }
 
         app->m_gui.render();
@@ -372,9 +424,11 @@ void Application::resizeCallback(GLFWwindow *window, int width, int height) {
     glfwSwapBuffers(window);
 }
 
-bool Application::newRomCallback(GLFWwindow *window, const char *path, fish::Chip8 &emu) {
+bool Application::newRomCallback(GLFWwindow *window, const char *path) {
+    Application *app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+
     //Try to load rom and if it fails notify the user with a message box
-    if(emu.loadRom(path) != fish::OK) {
+    if(!app->m_emu.loadRom(path, app->m_settings.quirks)) {
         std::string name = base_name(path);
         std::string message = "Failed to load ROM " + name;
         tinyfd_messageBox("Failed to Load New ROM", message.c_str(), "warning", "warning", true);
@@ -383,8 +437,7 @@ bool Application::newRomCallback(GLFWwindow *window, const char *path, fish::Chi
     }
 
     //Change title to show the rom
-    Application *app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
-    app->m_window.setTitle(app->m_title + " - " + emu.getRomInfo().name + emu.getRomInfo().ext);
+    app->m_window.setTitle(app->m_title + " - " + app->m_emu.getRomInfo().name + app->m_emu.getRomInfo().ext);
 
     return true;
 }
@@ -396,7 +449,8 @@ void Application::keyCallback(GLFWwindow* window, int key, int scancode, int act
     //Shortcuts defined in the gui, Emulator->Control->Start or Stop or Step
     if(key == GLFW_KEY_F1 && action == GLFW_PRESS) { app->m_settings.run_chip8 = true; app->m_settings.status = "Running"; };
     if(key == GLFW_KEY_F2 && action == GLFW_PRESS) { app->m_settings.run_chip8 = false; app->m_settings.status = "Halted (by user)"; };
-    if((key == GLFW_KEY_F3 && action == GLFW_PRESS) && !app->m_settings.run_chip8) { app->m_emu.cycle(1, app->m_emu_keys); app->m_settings.status = "Stepped"; };
+    if((key == GLFW_KEY_F3 && action == GLFW_PRESS) && !app->m_settings.run_chip8) { app->m_emu.step(); app->m_settings.status = "Stepped"; };
+    if(key == GLFW_KEY_F4 && action == GLFW_PRESS && !ImGui::GetIO().WantCaptureKeyboard) { app->m_settings.fast_forward = !app->m_settings.fast_forward; };
 
     //Toggle Gui and call the resize callback so things are resized for when the gui is there or not
     if(key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) { 
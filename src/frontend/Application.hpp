@@ -8,6 +8,7 @@
 #include "Gui.hpp"
 #include "Chip8.hpp"
 #include "Debugger.hpp"
+#include "EmulatorThread.hpp"
 
 struct Vec2f {
     float x;
@@ -24,13 +25,19 @@ private:
     Settings m_settings;
     std::string m_rom_path;
 
-    bool m_running_last;
+    bool m_running_last;  //The run state last handed to the emulation thread
     bool m_emu_keys[fish::CHIP8_NUM_KEYS];
-    fish::Chip8 m_emu;
-    fish::Debugger m_debug;
+    bool m_rewind_held;   //Rewinding is bound to holding backspace
+    bool m_fast_forward_held; //Fast forwarding to holding tab
+    EmulatorThread m_emu;
+    fish::Debugger m_debug; //Only disassembles, the emulation thread has its own attached to the emulator
+
+    uint64_t m_texture_frame;   //Number of the frame the texture was last updated from
 
     GLint m_uniform_dist;
     GLint m_uniform_ratio;
+    GLint m_uniform_foreground;
+    GLint m_uniform_background;
 
     ma_device m_device;
     ma_waveform m_sine_wave;
@@ -39,15 +46,16 @@ private:
     bool initAudio();
     void parseArgs(int argc, char **argv);
 
-    void updateEmulator(double delta, double error);
+    void updateEmulator();
+    void updateAudio();
     void updateTexture();
+    void updatePalette();
     void updateKeys();
     void updateUniforms(int width, int height);
     static Vec2f calcScreenRatio(float width, float height);
-    static bool detectLoop(fish::Chip8 &emu);
 
     static void resizeCallback(GLFWwindow *window, int width, int height);
-    static bool newRomCallback(GLFWwindow *window, const char *path, fish::Chip8 &emu);
+    static bool newRomCallback(GLFWwindow *window, const char *path);
     static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void refreshWindow(GLFWwindow *window);
     static void audioCallback(ma_device *device, void *output, const void *input, ma_uint32 frame_count);
@@ -0,0 +1,376 @@
+#include "EmulatorThread.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <future>
+
+#include "Log.hpp"
+
+EmulatorThread::EmulatorThread() {
+    m_quit = false;
+    m_running = false;
+    m_run_speed = fish::CHIP8_DEFAULT_CLOCK;
+    m_core = fish::THREADED_CORE;
+    m_quirks = fish::MODERN_QUIRKS;
+    m_sync_timers = false;
+    m_stop_timers = true;
+    m_detect_loop = true;
+    m_deterministic = false;
+    m_rewind_length = 0;
+    m_rewinding = false;
+    m_fast_forward = false;
+    m_fast_forward_speed = 0;
+    m_keys = 0;
+    m_loop_detected = false;
+    m_frame_number = 0;
+    memset(m_row_frames, 0, sizeof(m_row_frames));
+
+    m_debug.attach(m_emu);
+}
+
+EmulatorThread::~EmulatorThread() {
+    stop();
+    m_debug.detach();
+}
+
+void EmulatorThread::start() {
+    if(!m_thread.joinable()) {
+        m_quit = false;
+        m_thread = std::thread(&EmulatorThread::run, this);
+    }
+}
+
+void EmulatorThread::stop() {
+    if(m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_command_mutex);
+            m_quit = true;
+        }
+        m_command_cv.notify_one();
+        m_thread.join();
+    }
+}
+
+void EmulatorThread::run() {
+    m_pacer.reset();
+    bool running_last = false;
+    bool keys[fish::CHIP8_NUM_KEYS];
+
+    while(!m_quit) {
+        runCommands();
+        unpackKeys(keys);
+
+        m_emu.setRewindLength(m_rewind_length);
+        m_emu.setDeterministic(m_deterministic);
+
+        uint64_t ran = 0;
+        uint32_t target_rate = 0;
+
+        if(m_rewinding) {
+            //Rewinding works while halted too, so a halt on a loop can be backed out of
+            m_emu.rewindFrame();
+            m_recorder.truncate(m_emu);
+            running_last = false;
+        } else if(m_running && m_player.isPlaying()) {
+            //The movie decides the keys and settings
+            m_emu.setCore(m_core);
+            uint64_t cycles = m_emu.getCycleCount();
+            playMovieFrame(m_pacer.getFrameEnd());
+            ran = m_emu.getCycleCount() - cycles;
+            running_last = true;
+        } else if(m_running) {
+            //Check for loop
+            if(m_detect_loop && m_emu.detectLoop()) {
+                m_running = false;
+                m_loop_detected = true;
+            } else {
+                //Timers tick every run_speed / 60 cycles unless they are synced to the wall clock. A movie
+                //being recorded keeps the clock rate it started with, and runs its timers off cycles.
+                if(!m_recorder.isRecording()) {
+                    m_emu.setClockRate(m_run_speed);
+                    m_emu.setTimerMode(m_sync_timers ? fish::REALTIME_TIMERS : fish::CYCLE_TIMERS);
+                }
+                m_emu.setCore(m_core);
+
+                //Asked for after the clock rate is set, so the frame ends on the timer tick it causes
+                uint32_t rate = m_recorder.isRecording() ? m_emu.getClockRate() : m_run_speed.load();
+                uint32_t speed = m_fast_forward ? m_fast_forward_speed.load() : 1;
+                uint64_t cycles = m_emu.getCycleCount();
+
+                //Record the frame as it was before running it, rewinding one frame undoes the last one that ran
+                m_emu.recordRewindFrame();
+                m_recorder.update(m_emu, keys);
+
+                if(speed == 0) {
+                    fastForwardFrame(keys, m_pacer.getFrameEnd());
+                } else {
+                    //Fast forwarding at a multiple runs that many frames of emulated time, each still ending on a timer tick
+                    for(uint32_t i = 0; i < speed; i++) {
+                        m_emu.cycle(m_pacer.frameCycles(m_emu, rate), keys, m_stop_timers && !running_last && i == 0);
+                    }
+
+                    target_rate = rate * speed;
+                }
+
+                ran = m_emu.getCycleCount() - cycles;
+            }
+
+            running_last = true;
+        } else {
+            running_last = false;
+        }
+
+        //Frames can be skipped by the reader, so instead of the rows that changed in this frame it
+        //gets the frame each row last changed in and works out what changed since it last looked
+        m_frame_number++;
+        uint32_t dirty = m_emu.consumeDirtyRows();
+        for(uint32_t y = 0; y < fish::CHIP8_SCREEN_HEIGHT; y++) {
+            if((dirty >> y) & 1) { m_row_frames[y] = m_frame_number; }
+        }
+
+        //Hand the finished frame to the render thread
+        EmulatorFrame &frame = m_frames.back();
+        m_debug.capture(frame.state);
+        frame.number = m_frame_number;
+        memcpy(frame.row_frames, m_row_frames, sizeof(m_row_frames));
+        frame.rewind_frames = m_emu.getRewindFrameCount();
+        frame.rewind_bytes = m_emu.getRewindByteCount();
+        frame.movie_mode = m_recorder.isRecording() ? RECORDING_MOVIE : m_player.isPlaying() ? PLAYING_MOVIE : NO_MOVIE;
+        frame.movie_start = m_player.isPlaying() ? m_player.getMovie().keyframes.front().state.cycles : 0;
+        frame.movie_end = m_player.isPlaying() ? m_player.getMovie().end_cycle : 0;
+        frame.target_rate = target_rate;
+        frame.achieved_rate = m_pacer.getAchievedRate();
+        frame.frame_rate = m_pacer.getFrameRate();
+        frame.peak_rate = m_pacer.getPeakRate();
+        frame.dropped_frames = m_pacer.getDroppedFrames();
+        m_frames.publish();
+
+        m_pacer.endFrame(ran);
+
+        //Sleep until the next frame, a queued command wakes the thread up early so
+        //stepping and loading ROMs don't wait for it
+        std::unique_lock<std::mutex> lock(m_command_mutex);
+        m_command_cv.wait_until(lock, m_pacer.getFrameStart(), [this]() { return m_quit || !m_commands.empty(); });
+    }
+
+    //A recording still going when the program closes is kept
+    finishMovie();
+}
+
+void EmulatorThread::playMovieFrame(std::chrono::steady_clock::time_point deadline) {
+    //Runs in small batches until the frame is due, checking the clock in between
+    static constexpr uint64_t BATCH_CYCLES = 10000;
+
+    do {
+        m_player.run(m_emu, BATCH_CYCLES);
+    } while(!m_player.isFinished(m_emu) && std::chrono::steady_clock::now() < deadline);
+
+    //Once it is over the machine is handed back to the player
+    if(m_player.isFinished(m_emu)) {
+        m_player.stop();
+    }
+}
+
+void EmulatorThread::fastForwardFrame(const bool keys[fish::CHIP8_NUM_KEYS], std::chrono::steady_clock::time_point deadline) {
+    //Same batches as movie playback, big enough that reading the clock costs nothing next to them
+    static constexpr uint32_t BATCH_CYCLES = 10000;
+
+    do {
+        m_emu.cycle(BATCH_CYCLES, keys);
+    } while(std::chrono::steady_clock::now() < deadline);
+}
+
+void EmulatorThread::finishMovie() {
+    if(m_recorder.isRecording() && fish::saveMovieFile(m_movie_path, m_recorder.stop(m_emu)) != fish::OK) {
+        LOG_WARN("[APP]: Could not save the movie to %s", m_movie_path);
+    }
+
+    m_player.stop();
+}
+
+void EmulatorThread::runCommands() {
+    std::vector<Command> commands;
+
+    {
+        std::lock_guard<std::mutex> lock(m_command_mutex);
+        commands.swap(m_commands);
+    }
+
+    for(Command &command : commands) {
+        command(m_emu, m_debug);
+    }
+}
+
+void EmulatorThread::unpackKeys(bool keys[fish::CHIP8_NUM_KEYS]) const {
+    uint16_t mask = m_keys.load(std::memory_order_relaxed);
+
+    for(uint32_t i = 0; i < fish::CHIP8_NUM_KEYS; i++) {
+        keys[i] = (mask >> i) & 1;
+    }
+}
+
+void EmulatorThread::post(Command command) {
+    {
+        std::lock_guard<std::mutex> lock(m_command_mutex);
+        m_commands.push_back(std::move(command));
+    }
+    m_command_cv.notify_one();
+}
+
+bool EmulatorThread::loadRom(const std::string &path, fish::QuirkProfile quirks) {
+    //The command refers to this stack frame, so it can only be posted if it is run before returning
+    if(!m_thread.joinable()) {
+        return false;
+    }
+
+    std::promise<bool> loaded;
+    std::future<bool> result = loaded.get_future();
+    fish::RomInfo info;
+
+    //Pick the cores for the selected quirk profile before anything runs
+    post([&](fish::Chip8 &emu, fish::Debugger &debug) {
+        finishMovie();
+        emu.setQuirkProfile(quirks);
+
+        //A fresh seed every load unless runs have to be repeatable
+        uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        emu.setRandomSeed(m_deterministic ? fish::CHIP8_DEFAULT_SEED : seed);
+        bool success = emu.loadRom(path) == fish::OK;
+        info = emu.getRomInfo();
+        loaded.set_value(success);
+    });
+
+    bool success = result.get();
+    if(success) {
+        m_rom_info = info;
+    }
+
+    return success;
+}
+
+void EmulatorThread::step() {
+    post([this](fish::Chip8 &emu, fish::Debugger &debug) {
+        bool keys[fish::CHIP8_NUM_KEYS];
+        unpackKeys(keys);
+        emu.cycle(1, keys);
+    });
+}
+
+void EmulatorThread::startRecording(const std::string &path) {
+    post([this, path](fish::Chip8 &emu, fish::Debugger &debug) {
+        finishMovie();
+
+        //Keyframes are taken every ten seconds of emulated time
+        emu.setTimerMode(fish::CYCLE_TIMERS);
+        m_movie_path = path;
+        m_recorder.start(emu, static_cast<uint64_t>(emu.getClockRate()) * 10);
+    });
+}
+
+void EmulatorThread::stopRecording() {
+    post([this](fish::Chip8 &emu, fish::Debugger &debug) {
+        finishMovie();
+    });
+}
+
+bool EmulatorThread::playMovie(const std::string &path) {
+    //Same as loadRom, nothing may be left queued that points back into this frame
+    if(!m_thread.joinable()) {
+        return false;
+    }
+
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+
+    post([&](fish::Chip8 &emu, fish::Debugger &debug) {
+        finishMovie();
+
+        fish::Movie movie;
+        bool success = fish::loadMovieFile(path, movie) == fish::OK && m_player.start(emu, std::move(movie)) == fish::OK;
+        started.set_value(success);
+    });
+
+    return result.get();
+}
+
+void EmulatorThread::stopMovie() {
+    post([this](fish::Chip8 &emu, fish::Debugger &debug) {
+        m_player.stop();
+    });
+}
+
+void EmulatorThread::seekMovie(uint64_t cycle) {
+    post([this, cycle](fish::Chip8 &emu, fish::Debugger &debug) {
+        m_player.seek(emu, cycle);
+    });
+}
+
+void EmulatorThread::configure(const Settings &settings) {
+    m_run_speed = settings.run_speed;
+    m_core = settings.core;
+    m_sync_timers = settings.sync_timers;
+    m_stop_timers = settings.stop_timers;
+    m_detect_loop = settings.detect_loop;
+    m_deterministic = settings.deterministic;
+    m_rewind_length = settings.rewind_length * fish::CHIP8_TIMER_FREQ;
+    m_fast_forward_speed = settings.fast_forward_speed;
+
+    //The profile is picked when a ROM is loaded, after that it only changes when the setting does.
+    //A movie keeps the quirks it was recorded or played back with.
+    if(settings.quirks != m_quirks) {
+        m_quirks = settings.quirks;
+
+        fish::QuirkProfile quirks = m_quirks;
+        post([this, quirks](fish::Chip8 &emu, fish::Debugger &debug) {
+            if(!m_recorder.isRecording() && !m_player.isPlaying()) {
+                emu.setQuirkProfile(quirks);
+            }
+        });
+    }
+}
+
+void EmulatorThread::setRunning(bool running) {
+    m_running = running;
+}
+
+void EmulatorThread::setKeys(const bool keys[fish::CHIP8_NUM_KEYS]) {
+    uint16_t mask = 0;
+
+    for(uint32_t i = 0; i < fish::CHIP8_NUM_KEYS; i++) {
+        mask |= static_cast<uint16_t>(keys[i]) << i;
+    }
+
+    m_keys.store(mask, std::memory_order_relaxed);
+}
+
+void EmulatorThread::setRewinding(bool rewinding) {
+    m_rewinding = rewinding;
+}
+
+bool EmulatorThread::isRewinding() const {
+    return m_rewinding;
+}
+
+void EmulatorThread::setFastForward(bool fast_forward) {
+    m_fast_forward = fast_forward;
+}
+
+bool EmulatorThread::isFastForwarding() const {
+    return m_fast_forward;
+}
+
+bool EmulatorThread::takeLoopDetected() {
+    return m_loop_detected.exchange(false);
+}
+
+bool EmulatorThread::consumeFrame() {
+    return m_frames.consume();
+}
+
+const EmulatorFrame& EmulatorThread::getFrame() const {
+    return m_frames.front();
+}
+
+const fish::RomInfo& EmulatorThread::getRomInfo() const {
+    return m_rom_info;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Chip8.hpp"
+#include "Debugger.hpp"
+#include "FramePacer.hpp"
+#include "Movie.hpp"
+#include "Settings.hpp"
+#include "TripleBuffer.hpp"
+
+enum MovieMode {
+    NO_MOVIE, RECORDING_MOVIE, PLAYING_MOVIE
+};
+
+//What the emulation thread hands to the render thread after every frame
+struct EmulatorFrame {
+    fish::DebugSnapshot state = {};
+    uint64_t number = 0;                                //Counts up from 1 with every published frame
+    uint64_t row_frames[fish::CHIP8_SCREEN_HEIGHT] = {}; //The frame number each screen row last changed in
+    uint32_t rewind_frames = 0;                         //Frames that can be rewound
+    size_t rewind_bytes = 0;                            //Memory those frames take up
+    MovieMode movie_mode = NO_MOVIE;
+    uint64_t movie_start = 0;                           //The cycles a movie being played starts and ends at
+    uint64_t movie_end = 0;
+    uint32_t target_rate = 0;                           //Instructions per second asked for, 0 while not running at a set rate or fast forwarding without a limit
+    double achieved_rate = 0;                           //Instructions per second actually run, measured over the last half second
+    double peak_rate = 0;                               //Highest achieved rate so far
+    double frame_rate = 0;                              //Frames per second the thread managed
+    uint64_t dropped_frames = 0;                        //Frames given up on after falling behind
+};
+
+//Runs a Chip8 on its own thread at its configured rate, publishing a snapshot of the
+//machine every 60 Hz frame. The render thread never touches the emulator directly,
+//anything that changes it is queued and run on the emulation thread between frames.
+class EmulatorThread {
+public:
+
+    using Command = std::function<void(fish::Chip8 &emu, fish::Debugger &debug)>;
+
+private:
+
+    fish::Chip8 m_emu;
+    fish::Debugger m_debug;
+    fish::RomInfo m_rom_info; //Only touched by the render thread
+    fish::QuirkProfile m_quirks; //Last profile handed over by configure, only touched by the render thread
+
+    std::thread m_thread;
+    std::atomic<bool> m_quit;
+
+    //Settings, written by the render thread and picked up at the start of each frame
+    std::atomic<bool> m_running;
+    std::atomic<uint32_t> m_run_speed;
+    std::atomic<fish::CoreType> m_core;
+    std::atomic<bool> m_sync_timers;
+    std::atomic<bool> m_stop_timers;
+    std::atomic<bool> m_detect_loop;
+    std::atomic<bool> m_deterministic;
+    std::atomic<uint32_t> m_rewind_length; //In frames
+    std::atomic<bool> m_rewinding;
+    std::atomic<bool> m_fast_forward;
+    std::atomic<uint32_t> m_fast_forward_speed; //Multiple of the run speed, 0 for as fast as possible
+    std::atomic<uint16_t> m_keys; //One bit per key, same order as the key array
+    std::atomic<bool> m_loop_detected;
+
+    std::mutex m_command_mutex;
+    std::condition_variable m_command_cv;
+    std::vector<Command> m_commands;
+
+    fish::TripleBuffer<EmulatorFrame> m_frames;
+    uint64_t m_frame_number;                            //Only touched by the emulation thread
+    uint64_t m_row_frames[fish::CHIP8_SCREEN_HEIGHT];   //Only touched by the emulation thread
+
+    //Only touched by the emulation thread
+    fish::MovieRecorder m_recorder;
+    fish::MoviePlayer m_player;
+    std::string m_movie_path;
+    FramePacer m_pacer;
+
+    void run();
+    void playMovieFrame(std::chrono::steady_clock::time_point deadline);
+    void fastForwardFrame(const bool keys[fish::CHIP8_NUM_KEYS], std::chrono::steady_clock::time_point deadline);
+    void finishMovie();
+    void runCommands();
+    void unpackKeys(bool keys[fish::CHIP8_NUM_KEYS]) const;
+
+public:
+
+    EmulatorThread();
+    ~EmulatorThread();
+
+    void start();
+    void stop();
+
+    //Queues command to run on the emulation thread before its next frame
+    void post(Command command);
+    //Loads a ROM on the emulation thread and waits for the result
+    bool loadRom(const std::string &path, fish::QuirkProfile quirks);
+    void step();
+
+    //Recording writes the movie to path when it is stopped, or when another ROM is loaded
+    void startRecording(const std::string &path);
+    void stopRecording();
+    //Plays a movie back as fast as possible while running, false if it can't be played with the loaded ROM
+    bool playMovie(const std::string &path);
+    void stopMovie();
+    void seekMovie(uint64_t cycle);
+
+    void configure(const Settings &settings);
+    void setRunning(bool running);
+    void setRewinding(bool rewinding); //While set the thread steps back one frame per frame instead of running
+    bool isRewinding() const;
+    void setFastForward(bool fast_forward); //While set frames run faster than the run speed, still published once per 60 Hz frame
+    bool isFastForwarding() const;
+    void setKeys(const bool keys[fish::CHIP8_NUM_KEYS]);
+    bool takeLoopDetected(); //True once after the thread halted itself on a loop
+
+    //Render thread only. consumeFrame moves the newest published frame to getFrame and
+    //returns false if nothing was published since the last call.
+    bool consumeFrame();
+    const EmulatorFrame& getFrame() const;
+    const fish::RomInfo& getRomInfo() const;
+};
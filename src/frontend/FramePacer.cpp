@@ -0,0 +1,90 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+
+FramePacer::FramePacer() {
+    m_dropped = 0;
+    m_achieved_rate = 0;
+    m_peak_rate = 0;
+    m_frame_rate = 0;
+    reset();
+}
+
+void FramePacer::reset() {
+    m_start = Clock::now();
+    m_frame = 0;
+    m_remainder = 0;
+
+    m_window_start = m_start;
+    m_window_cycles = 0;
+    m_window_frames = 0;
+}
+
+uint32_t FramePacer::frameCycles(const fish::Chip8 &emu, uint32_t rate) {
+    //Below 60 Hz some frames have no tick at all, and the timers only follow rate if the clock does
+    uint32_t to_tick = emu.getCyclesToTimerTick();
+    if(to_tick > 0 && rate >= fish::CHIP8_TIMER_FREQ && emu.getClockRate() == rate) {
+        m_remainder = 0;
+        return to_tick;
+    }
+
+    uint64_t total = m_remainder + static_cast<uint64_t>(rate);
+    m_remainder = static_cast<uint32_t>(total % fish::CHIP8_TIMER_FREQ);
+    return static_cast<uint32_t>(total / fish::CHIP8_TIMER_FREQ);
+}
+
+FramePacer::Clock::time_point FramePacer::frameTime(uint64_t frame) const {
+    auto offset = std::chrono::duration<double>(frame / static_cast<double>(fish::CHIP8_TIMER_FREQ));
+    return m_start + std::chrono::duration_cast<Clock::duration>(offset);
+}
+
+FramePacer::Clock::time_point FramePacer::getFrameStart() const {
+    return frameTime(m_frame);
+}
+
+FramePacer::Clock::time_point FramePacer::getFrameEnd() const {
+    return frameTime(m_frame + 1);
+}
+
+void FramePacer::endFrame(uint64_t cycles) {
+    m_frame++;
+    m_window_cycles += cycles;
+    m_window_frames++;
+
+    Clock::time_point now = Clock::now();
+    double window = std::chrono::duration<double>(now - m_window_start).count();
+    if(window >= 0.5) {
+        m_achieved_rate = m_window_cycles / window;
+        m_peak_rate = std::max(m_peak_rate, m_achieved_rate);
+        m_frame_rate = m_window_frames / window;
+        m_window_start = now;
+        m_window_cycles = 0;
+        m_window_frames = 0;
+    }
+
+    //After a stall (a breakpoint, the machine was asleep) a few frames run back to back to
+    //catch up, anything later than that is dropped rather than run as one long burst
+    double late = std::chrono::duration<double>(now - getFrameStart()).count();
+    uint64_t behind = late > 0 ? static_cast<uint64_t>(late * fish::CHIP8_TIMER_FREQ) : 0;
+
+    if(behind > MAX_CATCH_UP) {
+        m_dropped += behind - MAX_CATCH_UP;
+        m_frame += behind - MAX_CATCH_UP;
+    }
+}
+
+double FramePacer::getAchievedRate() const {
+    return m_achieved_rate;
+}
+
+double FramePacer::getPeakRate() const {
+    return m_peak_rate;
+}
+
+double FramePacer::getFrameRate() const {
+    return m_frame_rate;
+}
+
+uint64_t FramePacer::getDroppedFrames() const {
+    return m_dropped;
+}
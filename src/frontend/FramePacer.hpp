@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "Chip8.hpp"
+
+//Paces the emulation thread at 60 frames a second and decides how many instructions each frame
+//runs. Deadlines are counted from a fixed start so rounding never adds up, a frame that is late
+//only gets a few frames of catch up, and what was actually run is measured against the rate
+//that was asked for.
+class FramePacer {
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t MAX_CATCH_UP = 4; //Late frames that run back to back before the rest are dropped
+
+private:
+
+    Clock::time_point frameTime(uint64_t frame) const;
+
+    Clock::time_point m_start;    //Frame n is due at m_start + n / 60 s
+    uint64_t m_frame;
+    uint32_t m_remainder;         //Instructions carried over to the next frame, in 60ths
+    uint64_t m_dropped;
+
+    //Achieved rates are measured over windows of about half a second
+    Clock::time_point m_window_start;
+    uint64_t m_window_cycles;
+    uint64_t m_window_frames;
+    double m_achieved_rate;
+    double m_peak_rate;
+    double m_frame_rate;
+
+public:
+
+    FramePacer();
+
+    void reset(); //Starts counting frames again from now
+
+    //Instructions to run this frame at rate per second. With cycle timers every frame ends on the
+    //instruction that ticks them, so each frame holds exactly one tick, otherwise the fraction
+    //that doesn't fit is carried to the next frame.
+    uint32_t frameCycles(const fish::Chip8 &emu, uint32_t rate);
+
+    //Call after every frame with the instructions it ran, moves on to the next one
+    void endFrame(uint64_t cycles);
+    Clock::time_point getFrameStart() const; //When the current frame is due
+    Clock::time_point getFrameEnd() const;   //When the one after it is
+
+    double getAchievedRate() const;  //Instructions per second
+    double getPeakRate() const;
+    double getFrameRate() const;
+    uint64_t getDroppedFrames() const;
+};
@@ -71,12 +71,27 @@ void Gui::render() {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwindow *window) {
+void Gui::update(Settings &settings, EmulatorThread &emu, GLFWwindow *window) {
     //Main Menu Bar
     ImGui::BeginMainMenuBar();
 
     if(ImGui::BeginMenu("File")) {
         ImGui::MenuItem("Open", nullptr, &m_show_rom_popup, !settings.run_chip8); //Don't allow new roms to be loaded while running
+        ImGui::Separator();
+
+        //Movies need a ROM to be recorded with or played back on
+        MovieMode movie_mode = emu.getFrame().movie_mode;
+        bool has_rom = !emu.getRomInfo().path.empty();
+        if(movie_mode == RECORDING_MOVIE) {
+            if(ImGui::MenuItem("Stop Recording")) { emu.stopRecording(); }
+        } else {
+            ImGui::MenuItem("Record Movie", nullptr, &m_show_record_popup, has_rom);
+        }
+        if(movie_mode == PLAYING_MOVIE) {
+            if(ImGui::MenuItem("Stop Movie")) { emu.stopMovie(); }
+        } else {
+            ImGui::MenuItem("Play Movie", nullptr, &m_show_play_popup, has_rom);
+        }
         ImGui::EndMenu();
     }
 
@@ -97,7 +112,10 @@ void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwin
         if(ImGui::BeginMenu("Control")) {
             if(ImGui::MenuItem("Start", "F1", false, !settings.run_chip8)) { settings.run_chip8 = true; settings.status = "Running"; }
             if(ImGui::MenuItem("Stop", "F2", false, settings.run_chip8)) { settings.run_chip8 = false; settings.status = "Halted (by user)"; }
-            if(ImGui::MenuItem("Step", "F3", false, !settings.run_chip8)) { emu.cycle(1, keys); settings.status = "Stepped"; }
+            if(ImGui::MenuItem("Step", "F3", false, !settings.run_chip8)) { emu.step(); settings.status = "Stepped"; }
+            ImGui::MenuItem("Fast Forward", "F4", &settings.fast_forward);
+            ImGui::MenuItem("Fast Forward (hold)", "Tab", false, false);
+            ImGui::MenuItem("Rewind (hold)", "Backspace", false, false); //Only a reminder, it is held down rather than clicked
 
             
 
@@ -134,7 +152,7 @@ void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwin
         const char *open_file_path = tinyfd_openFileDialog("Open", "./", num_filters, filters, nullptr, 0);
 
         if(open_file_path != nullptr) {
-            if(settings.new_rom_callback(window, open_file_path, emu)) { 
+            if(settings.new_rom_callback(window, open_file_path)) { 
                 settings.run_chip8 = true;
                 settings.status = "Running";
             }
@@ -143,6 +161,45 @@ void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwin
         m_show_rom_popup = false;
     }
 
+    static const char * const movie_filters[1] = {"*.f8m"};
+
+    if(m_show_record_popup) {
+        const char *save_file_path = tinyfd_saveFileDialog("Record Movie", "./movie.f8m", 1, movie_filters, nullptr);
+
+        if(save_file_path != nullptr) {
+            emu.startRecording(save_file_path);
+        }
+
+        m_show_record_popup = false;
+    }
+
+    if(m_show_play_popup) {
+        const char *open_file_path = tinyfd_openFileDialog("Play Movie", "./", 1, movie_filters, nullptr, 0);
+
+        if(open_file_path != nullptr) {
+            if(emu.playMovie(open_file_path)) {
+                settings.run_chip8 = true;
+                settings.status = "Running";
+            } else {
+                tinyfd_messageBox("Failed to Play Movie", "The movie could not be loaded, or was recorded with a different ROM", "ok", "warning", true);
+            }
+        }
+
+        m_show_play_popup = false;
+    }
+
+    //Seeking while a movie plays, it jumps to the closest keyframe and runs from there
+    const EmulatorFrame &frame = emu.getFrame();
+    if(frame.movie_mode == PLAYING_MOVIE) {
+        ImGui::Begin("Movie", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+        uint64_t cycle = frame.state.cycles;
+        if(ImGui::SliderScalar("Position", ImGuiDataType_U64, &cycle, &frame.movie_start, &frame.movie_end, "Cycle %llu")) { emu.seekMovie(cycle); }
+        if(ImGui::Button("Stop")) { emu.stopMovie(); }
+
+        ImGui::End();
+    }
+
     if(m_show_settings) {
         ImGui::Begin("Settings", &m_show_settings);
 
@@ -153,8 +210,28 @@ void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwin
 
         ImGui::Text("Execution:");
         ImGui::SliderScalar("Run Speed", ImGuiDataType_U32, &settings.run_speed, &uint_slider_min, &uint_slider_max, "%d Hz", ImGuiSliderFlags_AlwaysClamp);
-        ImGui::Checkbox("Freeze Timers When Not Running", &settings.stop_timers);
+        static const char *core_names[] = {"Interpreter", "Threaded", "JIT (x86-64)"};
+        int core = settings.core;
+        if(ImGui::Combo("Execution Core", &core, core_names, IM_ARRAYSIZE(core_names))) { settings.core = static_cast<fish::CoreType>(core); }
+        static const char *quirk_names[] = {"Modern", "COSMAC VIP", "CHIP-48", "SUPER-CHIP"};
+        int quirks = settings.quirks;
+        if(ImGui::Combo("Quirk Profile", &quirks, quirk_names, IM_ARRAYSIZE(quirk_names))) { settings.quirks = static_cast<fish::QuirkProfile>(quirks); }
+        ImGui::Checkbox("Deterministic", &settings.deterministic);
+        if(ImGui::IsItemHovered()) { ImGui::SetTooltip("Same random numbers every time a ROM is loaded and no real time timers"); }
+        if(!settings.deterministic) {
+            ImGui::Checkbox("Sync Timers to Real Time", &settings.sync_timers);
+            if(settings.sync_timers) {
+                ImGui::Checkbox("Freeze Timers When Not Running", &settings.stop_timers);
+            }
+        }
         ImGui::Checkbox("Halt on Loop Detection", &settings.detect_loop);
+        static const uint32_t rewind_min = 0, rewind_max = 600;
+        //1x would be no faster than running normally, so the bottom of the slider is Unlimited (0) followed by 2x
+        static const uint32_t fast_forward_min = 1, fast_forward_max = 16;
+        uint32_t fast_forward = settings.fast_forward_speed > 1 ? settings.fast_forward_speed : 1;
+        ImGui::SliderScalar("Fast Forward Speed", ImGuiDataType_U32, &fast_forward, &fast_forward_min, &fast_forward_max, fast_forward > 1 ? "%dx" : "Unlimited", ImGuiSliderFlags_AlwaysClamp);
+        settings.fast_forward_speed = fast_forward > 1 ? fast_forward : 0;
+        ImGui::SliderScalar("Rewind Length", ImGuiDataType_U32, &settings.rewind_length, &rewind_min, &rewind_max, settings.rewind_length > 0 ? "%d s (hold Backspace)" : "Off", ImGuiSliderFlags_AlwaysClamp);
         ImGui::Separator();
 
         ImGui::Text("Key Map: <[Chip8 Key]: [Mapped Key]>");
@@ -193,6 +270,8 @@ void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwin
         
         ImGui::Text("Audio:");
         ImGui::SliderFloat("Frequency", &settings.audio_freq, 220.0f, 2000.0f, "%.1f Hz", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::Checkbox("Mute While Fast Forwarding", &settings.fast_forward_mute);
+        if(ImGui::IsItemHovered()) { ImGui::SetTooltip("Otherwise the pitch goes up with the speed"); }
         ImGui::Separator();
         
         ImGui::Text("Graphics:");
@@ -223,7 +302,19 @@ void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwin
         ImGui::Begin("Info", &settings.gui_overlay, m_overlay_flags);
         
         ImGui::Text("Framerate: %.1f (vsync)", ImGui::GetIO().Framerate);
-        ImGui::Text("Status: %s", settings.status.c_str());
+        const EmulatorFrame &info = emu.getFrame();
+        if(info.target_rate > 0) {
+            ImGui::Text("Speed: %.0f / %u Hz (%.1f%%)", info.achieved_rate, info.target_rate, 100.0 * info.achieved_rate / info.target_rate);
+        } else {
+            ImGui::Text("Speed: %.0f Hz", info.achieved_rate);
+        }
+        ImGui::Text("Peak: %.0f Hz", info.peak_rate);
+        ImGui::Text("Emulation: %.1f fps, %llu dropped", info.frame_rate, static_cast<unsigned long long>(info.dropped_frames));
+        ImGui::Text("Status: %s%s", settings.status.c_str(), emu.isRewinding() ? " (rewinding)" : emu.isFastForwarding() ? " (fast forward)" : settings.run_chip8 && emu.getFrame().state.waiting_for_key ? " (waiting for key)" : "");
+        ImGui::Text("Rewind: %.1f s (%.1f KB)", emu.getFrame().rewind_frames / static_cast<float>(fish::CHIP8_TIMER_FREQ), emu.getFrame().rewind_bytes / 1024.0f);
+        if(emu.getFrame().movie_mode != NO_MOVIE) {
+            ImGui::Text("Movie: %s", emu.getFrame().movie_mode == RECORDING_MOVIE ? "Recording" : "Playing");
+        }
 
         if(settings.use_debug) {
             ImGui::Separator();
@@ -266,13 +357,25 @@ void Gui::update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwin
     }
 }
 
-void Gui::updateWithDebug(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwindow *window, fish::Debugger &debug) {
-    update(settings, emu, keys, window);
+void Gui::updateWithDebug(Settings &settings, EmulatorThread &emu, GLFWwindow *window, fish::Debugger &debug) {
+    update(settings, emu, window);
+
+    //Everything shown is from the last frame the emulation thread finished, edits are queued
+    //and show up in a later frame
+    const fish::DebugSnapshot &state = emu.getFrame().state;
 
     if(m_show_emu_mem) {
         static MemoryEditor mem_edit;
+        static EmulatorThread *mem_emu;
+
+        //Edits have to go through the debugger so the emulator's decoded instructions are invalidated,
+        //with WriteFn set the editor never writes to the snapshot itself
+        mem_emu = &emu;
+        mem_edit.WriteFn = [](ImU8 *data, size_t off, ImU8 d) {
+            mem_emu->post([off, d](fish::Chip8 &emu, fish::Debugger &debug) { debug.writeMemory(static_cast<uint16_t>(off), d); });
+        };
         m_show_emu_mem = mem_edit.Open;
-        mem_edit.DrawWindow("Memory", debug.getMemory(), fish::CHIP8_MEM_SIZE);
+        mem_edit.DrawWindow("Memory", const_cast<uint8_t*>(state.mem), fish::CHIP8_MEM_SIZE);
     }
 
     if(m_show_emu_reg) {
@@ -289,7 +392,10 @@ void Gui::updateWithDebug(Settings &settings, fish::Chip8 &emu, const bool *keys
         //V Registers
         for(uint32_t i = 0; i < fish::CHIP8_V_REG_COUNT; i++) {
             ImGui::Text("V%X:", i); ImGui::SameLine();
-            ImGui::SliderScalar(fmt::sprintf("##Reg_V%X", i).c_str(), ImGuiDataType_U8, debug.getVRegister(i), &u8_slider_min, &u8_slider_max, "%02X", slider_flags);
+            uint8_t v = state.regs.V[i];
+            if(ImGui::SliderScalar(fmt::sprintf("##Reg_V%X", i).c_str(), ImGuiDataType_U8, &v, &u8_slider_min, &u8_slider_max, "%02X", slider_flags)) {
+                emu.post([i, v](fish::Chip8 &emu, fish::Debugger &debug) { debug.setVRegister(i, v); });
+            }
 
             if(i % 2 == 0) {
                 ImGui::SameLine();
@@ -300,29 +406,47 @@ void Gui::updateWithDebug(Settings &settings, fish::Chip8 &emu, const bool *keys
 
         //Program Counter and I Register
         ImGui::Text("PC:"); ImGui::SameLine();
-        ImGui::SliderScalar("##Reg_PC", ImGuiDataType_U16, debug.getProgramCounter(), &u16_slider_min, &u16_slider_max, "%03X", slider_flags);
+        uint16_t pc = state.regs.PC;
+        if(ImGui::SliderScalar("##Reg_PC", ImGuiDataType_U16, &pc, &u16_slider_min, &u16_slider_max, "%03X", slider_flags)) {
+            emu.post([pc](fish::Chip8 &emu, fish::Debugger &debug) { debug.setProgramCounter(pc); });
+        }
         ImGui::Text("I :"); ImGui::SameLine();
-        ImGui::SliderScalar("##Reg_I", ImGuiDataType_U16, debug.getIRegister(), &u16_slider_min, &u16_slider_max, "%03X", slider_flags);
+        uint16_t index = state.regs.I;
+        if(ImGui::SliderScalar("##Reg_I", ImGuiDataType_U16, &index, &u16_slider_min, &u16_slider_max, "%03X", slider_flags)) {
+            emu.post([index](fish::Chip8 &emu, fish::Debugger &debug) { debug.setIRegister(index); });
+        }
         ImGui::Separator();
 
         //Timers
         ImGui::Text("Timers");
         ImGui::Text("Delay:"); ImGui::SameLine();
-        ImGui::SliderScalar("##Reg_DT", ImGuiDataType_U8, debug.getDelayTimer(), &u8_slider_min, &u8_slider_max, "%02X", slider_flags);
+        uint8_t dt = state.regs.DT;
+        if(ImGui::SliderScalar("##Reg_DT", ImGuiDataType_U8, &dt, &u8_slider_min, &u8_slider_max, "%02X", slider_flags)) {
+            emu.post([dt](fish::Chip8 &emu, fish::Debugger &debug) { debug.setDelayTimer(dt); });
+        }
         ImGui::Text("Sound:"); ImGui::SameLine();
-        ImGui::SliderScalar("##Reg_ST", ImGuiDataType_U8, debug.getSoundTimer(), &u8_slider_min, &u8_slider_max, "%02X", slider_flags);
+        uint8_t st = state.regs.ST;
+        if(ImGui::SliderScalar("##Reg_ST", ImGuiDataType_U8, &st, &u8_slider_min, &u8_slider_max, "%02X", slider_flags)) {
+            emu.post([st](fish::Chip8 &emu, fish::Debugger &debug) { debug.setSoundTimer(st); });
+        }
         ImGui::Separator();
 
         //Stack Pointer and Stack
         ImGui::Text("Stack");
         ImGui::Text("SP:"); ImGui::SameLine();
-        ImGui::SliderScalar("##Reg_SP", ImGuiDataType_U8, debug.getStackPointer(), &sp_slider_min, &sp_slider_max, "%i", slider_flags);
+        uint8_t sp = state.regs.SP;
+        if(ImGui::SliderScalar("##Reg_SP", ImGuiDataType_U8, &sp, &sp_slider_min, &sp_slider_max, "%i", slider_flags)) {
+            emu.post([sp](fish::Chip8 &emu, fish::Debugger &debug) { debug.setStackPointer(sp); });
+        }
 
         static const uint16_t stack_inp_step = 1;
 
         for(uint32_t i = 0; i < fish::CHIP8_STACK_MAX; i++) {
             ImGui::Text("%2i", i); ImGui::SameLine();
-            ImGui::InputScalar(fmt::sprintf("##Stack%i", i).c_str(), ImGuiDataType_U16, &(debug.getStack())[i], &stack_inp_step, &stack_inp_step, "%03X");
+            uint16_t entry = state.stack[i];
+            if(ImGui::InputScalar(fmt::sprintf("##Stack%i", i).c_str(), ImGuiDataType_U16, &entry, &stack_inp_step, &stack_inp_step, "%03X")) {
+                emu.post([i, entry](fish::Chip8 &emu, fish::Debugger &debug) { debug.setStackEntry(i, entry); });
+            }
         }
 
         ImGui::PopItemFlag();
@@ -333,9 +457,9 @@ void Gui::updateWithDebug(Settings &settings, fish::Chip8 &emu, const bool *keys
         ImGui::Begin("Disassembly", &m_show_emu_dis, ImGuiWindowFlags_AlwaysAutoResize);
 
         for(uint16_t i = 0; i < emu.getRomInfo().size; i += 2) {
-            uint16_t instr = debug.getInstructionAt(0x200 + i);
+            uint16_t instr = fish::Debugger::getInstructionAt(state, 0x200 + i);
             
-            if((0x200 + i) == *debug.getProgramCounter()) {
+            if((0x200 + i) == state.regs.PC) {
                 ImGui::PushStyleColor(ImGuiCol_FrameBg, 0x880000ff);
                 if(settings.run_chip8 && settings.dis_follow_pc) { ImGui::SetScrollHereY(); }
             } else {
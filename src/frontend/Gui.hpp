@@ -4,6 +4,7 @@
 
 #include "Settings.hpp"
 #include "Debugger.hpp"
+#include "EmulatorThread.hpp"
 
 enum Theme {
     DARK, LIGHT
@@ -13,6 +14,8 @@ class Gui {
 private:
 
     bool m_show_rom_popup = false;
+    bool m_show_record_popup = false;
+    bool m_show_play_popup   = false;
 
     bool m_show_settings  = false;
     int32_t edit_key      = -1;
@@ -42,8 +45,8 @@ public:
 
     void newFrame();
     void render();
-    void update(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwindow *window);
-    void updateWithDebug(Settings &settings, fish::Chip8 &emu, const bool *keys, GLFWwindow *window, fish::Debugger &debug);  //This method contains more debug gui
+    void update(Settings &settings, EmulatorThread &emu, GLFWwindow *window);
+    void updateWithDebug(Settings &settings, EmulatorThread &emu, GLFWwindow *window, fish::Debugger &debug);  //This method contains more debug gui
 
     float getFrameHeight(Settings &settings);  //This returns the height of the Main Menu Bar
 };
\ No newline at end of file
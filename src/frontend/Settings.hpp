@@ -17,7 +17,15 @@ struct Settings {
     bool detect_loop    = true;
     std::string status  = "Halted";
     uint32_t run_speed  = 500; //In Hz
+    uint32_t rewind_length = 60; //Seconds of history kept for rewinding, 0 turns it off
+    bool fast_forward   = false; //Toggled with F4, also on while Tab is held
+    uint32_t fast_forward_speed = 0; //Multiple of run_speed while fast forwarding, 0 runs as fast as the host can
+    bool fast_forward_mute = true; //Mute the sound while fast forwarding instead of raising its pitch
+    fish::CoreType core = fish::THREADED_CORE;
+    fish::QuirkProfile quirks = fish::MODERN_QUIRKS;
     bool stop_timers    = true; //Stop timers while not executing
+    bool sync_timers    = false; //Count the timers down by the wall clock instead of by executed cycles
+    bool deterministic  = false; //Never read the wall clock and seed RND the same way every time a ROM is loaded
     bool fill_screen    = false;
     bool gui_overlay    = false;
     bool dis_follow_pc  = false;
@@ -26,11 +34,6 @@ struct Settings {
     float foreground[3] = {1.0f, 1.0f, 1.0f}; //White
     //The default keys are as follows 1 2 3 4 Q W E R A S D F Z X C V, for 0x0 - 0xf as defined by glfw
     uint32_t key_map[fish::CHIP8_NUM_KEYS]  = {49, 50, 51, 52, 81, 87, 69, 82, 65, 83, 68, 70, 90, 88, 67, 86}; //This determines how keyboard keys map to the chip8's keys
-    bool (*new_rom_callback)(GLFWwindow *window, const char *path, fish::Chip8 &emu);
+    bool (*new_rom_callback)(GLFWwindow *window, const char *path);
     void (*refresh_screen)(GLFWwindow *window); //Used for instantly updating some value that won't be effected until screen resize
 };
-
-//Color Helper Function
-static uint32_t floatsToUint(float comps[3]) {
-    return static_cast<uint8_t>(comps[0] * 255) << 24 | static_cast<uint8_t>(comps[1] * 255) << 16 | static_cast<uint8_t>(comps[2] * 255) << 8 | 0xff;
-}
\ No newline at end of file
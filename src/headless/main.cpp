@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Chip8.hpp"
+#include "Log.hpp"
+#include "Movie.hpp"
+#include "ParallelRunner.hpp"
+#include "ScreenConvert.hpp"
+
+//Runs a ROM without a window, GPU, or audio device, for throughput measurements and
+//batch validation on machines without a display.
+
+struct KeyEvent {
+    uint64_t cycle;
+    uint8_t  key;   //Index into the key array
+    bool     down;
+};
+
+struct Options {
+    std::string rom_path;
+    std::vector<std::string> rom_paths; //Every ROM given, rom_path is the first
+    uint64_t cycles = 1000000;
+    uint64_t frames = 0;   //If set, overrides cycles with frames * rate / 60
+    uint32_t rate = fish::CHIP8_DEFAULT_CLOCK;
+    fish::CoreType core = fish::THREADED_CORE;
+    fish::QuirkProfile quirks = fish::MODERN_QUIRKS;
+    std::vector<KeyEvent> key_events;
+    std::string dump_path;
+    std::string record_path; //Write the run to a movie
+    std::string play_path;   //Play a movie back instead of running from key events
+    uint64_t seek = 0;       //Cycle to start playing the movie from
+    uint32_t dump_scale = 1;
+    bool skip_idle = true;
+    uint64_t seed = fish::CHIP8_DEFAULT_SEED;
+    uint32_t seeds = 1;      //Runs every ROM with this many seeds, counting up from seed
+    uint32_t jobs = 1;       //Worker threads, 0 for one per hardware thread
+};
+
+static void printHelp(const char *name) {
+    fmt::printf("Usage: %s [options...] rom-path [rom-path...]\n\nOptions:\n"
+                " %-22s - Number of instructions to run (default 1000000)\n"
+                " %-22s - Number of 60 Hz frames to run instead of a cycle count\n"
+                " %-22s - Clock rate in instructions per second (default %d)\n"
+                " %-22s - interpreter, threaded (default), or jit\n"
+                " %-22s - modern (default), vip, chip48, or schip\n"
+                " %-22s - Set key (0-f) down (1) or up (0) at cycle, can be repeated\n"
+                " %-22s - Read key events from a file, one \"cycle key state\" per line\n"
+                " %-22s - Write the final screen to a PBM, PGM, or PPM image, picked by extension\n"
+                " %-22s - Record the run, with its key events, to a movie\n"
+                " %-22s - Play a movie recorded with this ROM back as fast as possible\n"
+                " %-22s - Start playing the movie at this cycle\n"
+                " %-22s - Pixel size of PGM and PPM images (default 1)\n"
+                " %-22s - Execute idle loops instead of skipping over them\n"
+                " %-22s - Seed for RND, the same seed and keys always give the same run\n"
+                " %-22s - Run every ROM with n seeds, counting up from --seed\n"
+                " %-22s - Run the ROMs and seeds on n threads, 0 for one per hardware thread\n"
+                " %-22s - Shows this help message\n",
+                name, "-c --cycles <n>", "-f --frames <n>", "-r --rate <hz>", fish::CHIP8_DEFAULT_CLOCK, "--core <name>", "--quirks <profile>",
+                "-k --key <cycle:key:state>", "--keys <file>", "--dump <file>", "--record <file>", "--play <file>", "--seek <cycle>", "--scale <n>", "--no-idle-skip", "--seed <n>", "--seeds <n>", "-j --jobs <n>", "-h --help");
+}
+
+static bool parseKeyEvent(const std::string &text, KeyEvent &event) {
+    unsigned long long cycle;
+    unsigned int key, state;
+
+    if(sscanf(text.c_str(), "%llu%*[: ]%x%*[: ]%u", &cycle, &key, &state) != 3 || key >= fish::CHIP8_NUM_KEYS) {
+        return false;
+    }
+
+    event = {cycle, static_cast<uint8_t>(key), state != 0};
+    return true;
+}
+
+static bool loadKeyFile(const std::string &path, std::vector<KeyEvent> &events) {
+    std::ifstream file(path);
+
+    if(!file.good()) {
+        LOG_ERROR("[HDL]: Could not open key file %s", path);
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(file, line)) {
+        if(line.empty() || line[0] == '#') { continue; }
+
+        KeyEvent event;
+        if(!parseKeyEvent(line, event)) {
+            LOG_ERROR("[HDL]: Invalid key event \"%s\" in %s", line, path);
+            return false;
+        }
+
+        events.push_back(event);
+    }
+
+    return true;
+}
+
+//Parses the value of a numeric option, the whole text has to be a number that fits in T
+template<typename T>
+static bool parseNumber(const char *option, const char *text, T &value, int base = 10) {
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long parsed = strtoull(text, &end, base);
+
+    //strtoull takes negative numbers and wraps them around
+    if(end == text || *end != '\0' || errno == ERANGE || strchr(text, '-') != nullptr || parsed > std::numeric_limits<T>::max()) {
+        LOG_ERROR("[HDL]: Invalid value %s for %s", text, option);
+        return false;
+    }
+
+    value = static_cast<T>(parsed);
+    return true;
+}
+
+static bool parseArgs(int argc, char **argv, Options &options) {
+    bool seek = false;
+
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(argv[i][0] == '-') {
+            if((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--cycles") == 0) && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.cycles)) { return false; }
+                i++;
+            } else if((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--frames") == 0) && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.frames)) { return false; }
+                i++;
+            } else if((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.rate)) { return false; }
+                i++;
+            } else if(strcmp(argv[i], "--core") == 0 && has_value) {
+                std::string core = argv[++i];
+                if(core == "interpreter") { options.core = fish::INTERPRETER_CORE; }
+                else if(core == "threaded") { options.core = fish::THREADED_CORE; }
+                else if(core == "jit") { options.core = fish::JIT_CORE; }
+                else { LOG_ERROR("[HDL]: Unknown core %s", core); return false; }
+            } else if(strcmp(argv[i], "--quirks") == 0 && has_value) {
+                std::string quirks = argv[++i];
+                if(quirks == "modern") { options.quirks = fish::MODERN_QUIRKS; }
+                else if(quirks == "vip") { options.quirks = fish::COSMAC_VIP_QUIRKS; }
+                else if(quirks == "chip48") { options.quirks = fish::CHIP48_QUIRKS; }
+                else if(quirks == "schip") { options.quirks = fish::SCHIP_QUIRKS; }
+                else { LOG_ERROR("[HDL]: Unknown quirk profile %s", quirks); return false; }
+            } else if((strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--key") == 0) && has_value) {
+                KeyEvent event;
+                if(!parseKeyEvent(argv[++i], event)) { LOG_ERROR("[HDL]: Invalid key event %s", argv[i]); return false; }
+                options.key_events.push_back(event);
+            } else if(strcmp(argv[i], "--keys") == 0 && has_value) {
+                if(!loadKeyFile(argv[++i], options.key_events)) { return false; }
+            } else if(strcmp(argv[i], "--dump") == 0 && has_value) {
+                options.dump_path = argv[++i];
+            } else if(strcmp(argv[i], "--record") == 0 && has_value) {
+                options.record_path = argv[++i];
+            } else if(strcmp(argv[i], "--play") == 0 && has_value) {
+                options.play_path = argv[++i];
+            } else if(strcmp(argv[i], "--seek") == 0 && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.seek)) { return false; }
+                i++;
+                seek = true;
+            } else if(strcmp(argv[i], "--scale") == 0 && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.dump_scale)) { return false; }
+                options.dump_scale = std::max<uint32_t>(1, options.dump_scale);
+                i++;
+            } else if(strcmp(argv[i], "--seed") == 0 && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.seed, 0)) { return false; }
+                i++;
+            } else if(strcmp(argv[i], "--seeds") == 0 && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.seeds)) { return false; }
+                options.seeds = std::max<uint32_t>(1, options.seeds);
+                i++;
+            } else if((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) && has_value) {
+                if(!parseNumber(argv[i], argv[i + 1], options.jobs)) { return false; }
+                i++;
+            } else if(strcmp(argv[i], "--no-idle-skip") == 0) {
+                options.skip_idle = false;
+            } else if((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0)) {
+                printHelp(argv[0]);
+                std::exit(0);
+            } else {
+                LOG_ERROR("[HDL]: Unknown option or missing value %s", argv[i]);
+                return false;
+            }
+        } else {
+            options.rom_paths.push_back(argv[i]);
+        }
+    }
+
+    if(options.rom_paths.empty()) {
+        return false;
+    }
+
+    if(seek && options.play_path.empty()) {
+        LOG_ERROR("[HDL]: --seek needs a movie to play with --play");
+        return false;
+    }
+
+    options.rom_path = options.rom_paths[0];
+
+    if(options.frames > 0) {
+        if(options.rate > 0 && options.frames > std::numeric_limits<uint64_t>::max() / options.rate) {
+            LOG_ERROR("[HDL]: %llu frames at %u Hz is more instructions than can be counted", options.frames, options.rate);
+            return false;
+        }
+
+        options.cycles = options.frames * options.rate / fish::CHIP8_TIMER_FREQ;
+    }
+
+    return true;
+}
+
+static bool writePbm(const std::string &path, const fish::Chip8 &emu) {
+    std::ofstream file(path, std::ios::binary);
+
+    if(!file.good()) {
+        return false;
+    }
+
+    //Binary PBM packs 8 pixels per byte with the leftmost pixel in the high bit, the same order as the screen rows.
+    //A set bit is black in PBM, so the rows are inverted to get white pixels on black like the other formats.
+    file << "P4\n" << fish::CHIP8_SCREEN_WIDTH << " " << fish::CHIP8_SCREEN_HEIGHT << "\n";
+
+    for(uint32_t y = 0; y < fish::CHIP8_SCREEN_HEIGHT; y++) {
+        uint64_t row = emu.getScreenRow(y);
+
+        for(int32_t shift = fish::CHIP8_SCREEN_WIDTH - 8; shift >= 0; shift -= 8) {
+            file.put(static_cast<char>((~row >> shift) & 0xff));
+        }
+    }
+
+    return file.good();
+}
+
+//Binary PGM or PPM, scaled up and with white pixels on black
+static bool writePnm(const std::string &path, const fish::Chip8 &emu, fish::PixelFormat format, uint32_t scale) {
+    std::ofstream file(path, std::ios::binary);
+
+    if(!file.good()) {
+        return false;
+    }
+
+    std::vector<uint8_t> pixels(fish::convertedScreenSize(format, scale));
+    fish::convertScreen(emu.getScreenRows(), fish::CHIP8_SCREEN_HEIGHT, pixels.data(), format, scale, 0xffffffff, 0x000000ff);
+
+    file << (format == fish::PIXEL_GRAY8 ? "P5\n" : "P6\n") << fish::CHIP8_SCREEN_WIDTH * scale << " " << fish::CHIP8_SCREEN_HEIGHT * scale << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+
+    return file.good();
+}
+
+static bool writeScreen(const std::string &path, const fish::Chip8 &emu, uint32_t scale) {
+    std::string ext = path.substr(path.find_last_of('.') + 1);
+
+    if(ext == "pgm") { return writePnm(path, emu, fish::PIXEL_GRAY8, scale); }
+    if(ext == "ppm") { return writePnm(path, emu, fish::PIXEL_RGB8, scale); }
+
+    return writePbm(path, emu);
+}
+
+//Runs every ROM with every seed, spread over the worker threads, and prints a line for each
+static int runParallel(const Options &options) {
+    if(!options.key_events.empty() || !options.record_path.empty() || !options.play_path.empty() || !options.dump_path.empty()) {
+        LOG_ERROR("[HDL]: Keys, movies and screen dumps only work with a single ROM, seed and job");
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<fish::Chip8>> machines;
+    std::vector<fish::Chip8*> pointers;
+
+    for(const std::string &path : options.rom_paths) {
+        for(uint32_t i = 0; i < options.seeds; i++) {
+            std::unique_ptr<fish::Chip8> emu(new fish::Chip8());
+            emu->setDeterministic(true);
+            emu->setRandomSeed(options.seed + i);
+            emu->setQuirkProfile(options.quirks);
+
+            if(emu->loadRom(path) != fish::OK) {
+                return 1;
+            }
+
+            emu->setClockRate(options.rate);
+            emu->setCore(options.core);
+            emu->setIdleSkipping(options.skip_idle);
+
+            pointers.push_back(emu.get());
+            machines.push_back(std::move(emu));
+        }
+    }
+
+    //A quantum is one frame, so the frame hash covers the screen at every frame
+    fish::RunBudget budget;
+    budget.cycles = options.cycles;
+    budget.quantum = std::max<uint32_t>(1, options.rate / fish::CHIP8_TIMER_FREQ);
+    budget.slice = 0.001;
+
+    fish::ParallelRunner runner(options.jobs);
+    std::vector<fish::RunResult> results(machines.size());
+
+    auto start = std::chrono::steady_clock::now();
+    runner.run(pointers.data(), pointers.size(), budget, results.data());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total_cycles = 0;
+
+    for(size_t i = 0; i < machines.size(); i++) {
+        const fish::RunResult &result = results[i];
+        total_cycles += result.cycles;
+
+        fmt::printf("%s seed=%016llx cycles=%llu idle=%llu framebuffer=%016llx frames=%016llx\n", base_name(machines[i]->getRomInfo().path),
+                    static_cast<unsigned long long>(options.seed + i % options.seeds), static_cast<unsigned long long>(result.cycles),
+                    static_cast<unsigned long long>(result.idle_cycles), static_cast<unsigned long long>(result.screen_hash),
+                    static_cast<unsigned long long>(result.frame_hash));
+    }
+
+    fmt::printf("machines:         %llu\n", static_cast<unsigned long long>(machines.size()));
+    fmt::printf("threads:          %u\n", runner.getThreadCount());
+    fmt::printf("steals:           %llu\n", static_cast<unsigned long long>(runner.getStealCount()));
+    fmt::printf("time:             %.6f s\n", seconds);
+    fmt::printf("instructions/s:   %.0f\n", seconds > 0 ? total_cycles / seconds : 0.0);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if(!parseArgs(argc, argv, options)) {
+        printHelp(argv[0]);
+        return 1;
+    }
+
+    if(options.rom_paths.size() > 1 || options.seeds > 1 || options.jobs != 1) {
+        return runParallel(options);
+    }
+
+    //Nothing is read from the wall clock, so the same ROM, seed and keys always give the same result
+    fish::Chip8 emu;
+    emu.setDeterministic(true);
+    emu.setRandomSeed(options.seed);
+    emu.setQuirkProfile(options.quirks);
+
+    if(emu.loadRom(options.rom_path) != fish::OK) {
+        return 1;
+    }
+
+    emu.setClockRate(options.rate);
+    emu.setCore(options.core);
+    emu.setIdleSkipping(options.skip_idle);
+
+    auto start = std::chrono::steady_clock::now();
+
+    if(!options.play_path.empty()) {
+        //The movie sets the quirk profile and clock rate it was recorded with
+        fish::Movie movie;
+        fish::MoviePlayer player;
+
+        if(fish::loadMovieFile(options.play_path, movie) != fish::OK || player.start(emu, std::move(movie)) != fish::OK) {
+            LOG_ERROR("[HDL]: Could not play %s", options.play_path);
+            return 1;
+        }
+
+        start = std::chrono::steady_clock::now();
+        player.seek(emu, options.seek);
+        player.run(emu, UINT64_MAX);
+    } else {
+        std::stable_sort(options.key_events.begin(), options.key_events.end(), [](const KeyEvent &a, const KeyEvent &b) { return a.cycle < b.cycle; });
+
+        bool keys[fish::CHIP8_NUM_KEYS] = {};
+        size_t next_event = 0;
+        uint64_t cycle = 0;
+
+        //Keyframes every ten seconds of emulated time
+        fish::MovieRecorder recorder;
+        if(!options.record_path.empty()) {
+            recorder.start(emu, static_cast<uint64_t>(options.rate) * 10);
+        }
+
+        //Run up to each key event, apply it, and carry on until the budget is used up
+        while(cycle < options.cycles) {
+            while(next_event < options.key_events.size() && options.key_events[next_event].cycle <= cycle) {
+                keys[options.key_events[next_event].key] = options.key_events[next_event].down;
+                next_event++;
+            }
+
+            uint64_t stop = options.cycles;
+            if(next_event < options.key_events.size()) {
+                stop = std::min(stop, options.key_events[next_event].cycle);
+            }
+
+            //cycle() takes a 32-bit count
+            uint32_t num = static_cast<uint32_t>(std::min<uint64_t>(stop - cycle, UINT32_MAX));
+            recorder.update(emu, keys);
+            emu.cycle(num, keys);
+            cycle += num;
+        }
+
+        if(recorder.isRecording() && fish::saveMovieFile(options.record_path, recorder.stop(emu)) != fish::OK) {
+            LOG_ERROR("[HDL]: Could not write %s", options.record_path);
+            return 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fmt::printf("rom:              %s\n", options.rom_path);
+    fmt::printf("cycles:           %llu\n", static_cast<unsigned long long>(emu.getCycleCount()));
+    fmt::printf("idle cycles:      %llu\n", static_cast<unsigned long long>(emu.getIdleCycleCount()));
+    fmt::printf("time:             %.6f s\n", seconds);
+    fmt::printf("instructions/s:   %.0f\n", seconds > 0 ? emu.getCycleCount() / seconds : 0.0);
+    fmt::printf("framebuffer hash: %016llx\n", static_cast<unsigned long long>(emu.getScreenHash()));
+
+    if(!options.dump_path.empty() && !writeScreen(options.dump_path, emu, options.dump_scale)) {
+        LOG_ERROR("[HDL]: Could not write %s", options.dump_path);
+        return 1;
+    }
+
+    return 0;
+}
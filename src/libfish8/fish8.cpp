@@ -0,0 +1,161 @@
+#include "fish8.h"
+
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "Chip8.hpp"
+#include "SaveState.hpp"
+
+static_assert(FISH8_SCREEN_WIDTH == fish::CHIP8_SCREEN_WIDTH && FISH8_SCREEN_HEIGHT == fish::CHIP8_SCREEN_HEIGHT, "C screen size doesn't match the emulator's");
+static_assert(FISH8_QUIRKS_SCHIP == static_cast<int>(fish::SCHIP_QUIRKS), "fish8_quirks has to match QuirkProfile");
+
+struct fish8_machine {
+    fish::Chip8 emu;
+    bool keys[fish::CHIP8_NUM_KEYS] = {};
+    uint8_t pixels[fish::CHIP8_SCREEN_PIXELS] = {}; //What fish8_framebuffer hands out
+};
+
+//Brings the pixels up to date, only for the rows that changed since the last time
+static void updateFramebuffer(fish8_machine *machine) {
+    uint32_t dirty = machine->emu.consumeDirtyRows();
+    const uint64_t *rows = machine->emu.getScreenRows();
+
+    for(uint32_t y = 0; y < fish::CHIP8_SCREEN_HEIGHT; y++) {
+        if(!(dirty & (1u << y))) { continue; }
+
+        uint8_t *out = &machine->pixels[y * fish::CHIP8_SCREEN_WIDTH];
+        for(uint32_t x = 0; x < fish::CHIP8_SCREEN_WIDTH; x++) {
+            out[x] = (rows[y] >> (fish::CHIP8_SCREEN_WIDTH - 1 - x)) & 1;
+        }
+    }
+}
+
+extern "C" {
+
+uint32_t fish8_abi_version(void) {
+    return FISH8_ABI_VERSION;
+}
+
+fish8_machine* fish8_create(void) {
+    //Nothing may throw across the C boundary
+    fish8_machine *machine = nullptr;
+    try {
+        machine = new fish8_machine();
+    } catch(const std::bad_alloc &) {
+        return nullptr;
+    }
+
+    machine->emu.setDeterministic(true);
+    updateFramebuffer(machine);
+    return machine;
+}
+
+void fish8_destroy(fish8_machine *machine) {
+    delete machine;
+}
+
+fish8_status fish8_load_rom(fish8_machine *machine, const uint8_t *data, size_t size) {
+    if(machine == nullptr || data == nullptr) { return FISH8_INVALID_ARGUMENT; }
+
+    try {
+        if(machine->emu.loadRom(data, size) != fish::OK) {
+            return FISH8_INVALID_SIZE;
+        }
+    } catch(const std::bad_alloc &) {
+        return FISH8_OUT_OF_MEMORY;
+    }
+
+    updateFramebuffer(machine);
+    return FISH8_OK;
+}
+
+void fish8_set_clock_rate(fish8_machine *machine, uint32_t hz) {
+    if(machine == nullptr) { return; }
+    machine->emu.setClockRate(hz);
+}
+
+void fish8_set_quirks(fish8_machine *machine, fish8_quirks quirks) {
+    if(machine == nullptr || quirks < FISH8_QUIRKS_MODERN || quirks > FISH8_QUIRKS_SCHIP) { return; }
+    machine->emu.setQuirkProfile(static_cast<fish::QuirkProfile>(quirks));
+}
+
+void fish8_set_seed(fish8_machine *machine, uint64_t seed) {
+    if(machine == nullptr) { return; }
+    machine->emu.setRandomSeed(seed);
+}
+
+void fish8_set_keys(fish8_machine *machine, uint16_t keys) {
+    if(machine == nullptr) { return; }
+
+    for(uint32_t i = 0; i < fish::CHIP8_NUM_KEYS; i++) {
+        machine->keys[i] = (keys >> i) & 1;
+    }
+}
+
+uint64_t fish8_run_cycles(fish8_machine *machine, uint32_t num) {
+    if(machine == nullptr) { return 0; }
+
+    machine->emu.cycle(num, machine->keys);
+    updateFramebuffer(machine);
+
+    return machine->emu.getCycleCount();
+}
+
+int fish8_sound_active(const fish8_machine *machine) {
+    if(machine == nullptr) { return 0; }
+    return machine->emu.shouldPlaySound();
+}
+
+const uint8_t* fish8_framebuffer(const fish8_machine *machine) {
+    if(machine == nullptr) { return nullptr; }
+    return machine->pixels;
+}
+
+const uint64_t* fish8_screen_rows(const fish8_machine *machine) {
+    if(machine == nullptr) { return nullptr; }
+    return machine->emu.getScreenRows();
+}
+
+uint64_t fish8_screen_hash(const fish8_machine *machine) {
+    if(machine == nullptr) { return 0; }
+    return machine->emu.getScreenHash();
+}
+
+size_t fish8_snapshot(const fish8_machine *machine, uint8_t *buffer, size_t capacity) {
+    if(machine == nullptr) { return 0; }
+
+    try {
+        fish::MachineState state;
+        machine->emu.saveState(state);
+        std::vector<uint8_t> data = fish::serializeState(state);
+
+        if(buffer != nullptr && capacity >= data.size()) {
+            memcpy(buffer, data.data(), data.size());
+        }
+
+        return data.size();
+    } catch(const std::bad_alloc &) {
+        return 0;
+    }
+}
+
+fish8_status fish8_restore(fish8_machine *machine, const uint8_t *data, size_t size) {
+    if(machine == nullptr || data == nullptr) { return FISH8_INVALID_ARGUMENT; }
+
+    try {
+        fish::MachineState state;
+        if(fish::deserializeState(data, size, state) != fish::OK) {
+            return FISH8_INVALID_STATE;
+        }
+
+        machine->emu.loadState(state);
+    } catch(const std::bad_alloc &) {
+        return FISH8_OUT_OF_MEMORY;
+    }
+
+    updateFramebuffer(machine);
+    return FISH8_OK;
+}
+
+}
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fmt/printf.h>
+
+#include "BatchCore.hpp"
+#include "Chip8.hpp"
+#include "Fork.hpp"
+#include "Movie.hpp"
+#include "SaveState.hpp"
+
+//Checks that need more than a quick run of the GUI to see, each group returns the number of
+//failures. Run through ctest, or by hand as fish-tests <group> <roms directory>.
+
+using namespace fish;
+
+struct Rom {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+static constexpr uint32_t FRAME = CHIP8_DEFAULT_CLOCK / CHIP8_TIMER_FREQ + 1; //Not a whole timer tick, so frames end part way through one
+
+static bool sameState(const MachineState &a, const MachineState &b) {
+    //MachineState has padding, so it is compared field by field
+    return memcmp(a.regs.V, b.regs.V, sizeof(a.regs.V)) == 0 && a.regs.I == b.regs.I && a.regs.PC == b.regs.PC &&
+           a.regs.SP == b.regs.SP && a.regs.DT == b.regs.DT && a.regs.ST == b.regs.ST && a.regs.RNG == b.regs.RNG &&
+           a.last_pc == b.last_pc && memcmp(a.stack, b.stack, sizeof(a.stack)) == 0 && memcmp(a.mem, b.mem, sizeof(a.mem)) == 0 &&
+           memcmp(a.screen, b.screen, sizeof(a.screen)) == 0 && a.cycles == b.cycles && a.idle_cycles == b.idle_cycles &&
+           a.timer_accum == b.timer_accum && a.waiting_for_key == b.waiting_for_key;
+}
+
+static MachineState savedState(const Chip8 &emu) {
+    MachineState state;
+    memset(&state, 0, sizeof(state));
+    emu.saveState(state);
+    return state;
+}
+
+//Returns 1 and says what went wrong if the states differ
+static uint32_t expectSame(const MachineState &expected, const MachineState &actual, const std::string &what) {
+    if(sameState(expected, actual)) { return 0; }
+
+    fmt::printf("FAIL %s: PC %03X cycle %llu, expected PC %03X cycle %llu\n", what, actual.regs.PC, actual.cycles, expected.regs.PC, expected.cycles);
+    return 1;
+}
+
+static std::vector<Rom> loadRoms(const std::string &roms_dir) {
+    std::vector<Rom> roms;
+
+    for(const auto &entry : std::filesystem::directory_iterator(roms_dir)) {
+        if(!entry.is_regular_file() || entry.file_size() == 0 || entry.file_size() > CHIP8_ROM_MAX) { continue; }
+
+        std::ifstream file(entry.path(), std::ios::binary);
+        roms.push_back({entry.path().filename().string(), std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>())});
+    }
+
+    //Directory order isn't the same everywhere, sorted the failures always come out the same
+    std::sort(roms.begin(), roms.end(), [](const Rom &a, const Rom &b) { return a.name < b.name; });
+
+    if(roms.empty()) {
+        fmt::printf("FAIL no ROMs found in %s\n", roms_dir);
+    }
+
+    return roms;
+}
+
+//Every machine a group compares starts like this, so a run only depends on the ROM, quirks, seed and keys
+static void bootMachine(Chip8 &emu, const Rom &rom, QuirkProfile quirks, uint64_t seed) {
+    emu.setDeterministic(true);
+    emu.setQuirkProfile(quirks);
+    emu.setRandomSeed(seed);
+    emu.loadRom(rom.data.data(), rom.data.size(), rom.name);
+}
+
+//Now and then a random key, so the machines waiting on one move on at different times
+static uint16_t randomKeys(uint64_t &rng) {
+    uint32_t draw = nextRandom(rng);
+    return (draw & 0xf0) == 0 ? 1u << (draw >> 28) : 0;
+}
+
+static void runFrame(Chip8 &emu, uint16_t keys, uint32_t cycles = FRAME) {
+    bool down[CHIP8_NUM_KEYS];
+    unpackKeys(keys, down);
+    emu.cycle(cycles, down);
+}
+
+//Runs every machine of a BatchCore next to a Chip8 set up the same way, and compares them. The
+//machines in skip are run but not compared, they are there to disturb their neighbours.
+static uint32_t compareBatch(const std::string &name, const std::vector<Rom> &roms, QuirkProfile quirks, SimdLevel level, uint32_t clock, const std::vector<uint32_t> &skip) {
+    const uint32_t size = static_cast<uint32_t>(roms.size());
+
+    std::vector<Chip8> reference(size);
+    BatchCore batch(size);
+    batch.setQuirkProfile(quirks);
+    batch.setClockRate(clock);
+    batch.setSimdLevel(level);
+
+    MachineState state;
+    for(uint32_t i = 0; i < size; i++) {
+        reference[i].setIdleSkipping(false);
+        reference[i].setClockRate(clock);
+        bootMachine(reference[i], roms[i], quirks, i);
+
+        reference[i].saveState(state);
+        batch.loadState(i, state);
+    }
+
+    std::vector<uint16_t> keys(size);
+    uint64_t rng = seedRandom(size);
+
+    for(uint32_t frame = 0; frame < 300; frame++) {
+        for(uint32_t i = 0; i < size; i++) {
+            keys[i] = randomKeys(rng);
+            runFrame(reference[i], keys[i], clock / CHIP8_TIMER_FREQ + 1);
+        }
+
+        batch.cycle(clock / CHIP8_TIMER_FREQ + 1, keys.data());
+    }
+
+    uint32_t failures = 0;
+
+    for(uint32_t i = 0; i < size; i++) {
+        if(std::find(skip.begin(), skip.end(), i) != skip.end()) { continue; }
+
+        memset(&state, 0, sizeof(state));
+        batch.saveState(i, state);
+        failures += expectSame(savedState(reference[i]), state, fmt::sprintf("%s quirks %d simd %d clock %u machine %u", name, quirks, level, clock, i));
+    }
+
+    return failures;
+}
+
+static uint32_t testBatch(const std::vector<Rom> &roms) {
+    //CALL to itself forever, SP runs through every value it can hold
+    const Rom runaway = {"runaway", {0x22, 0x00}};
+
+    uint32_t failures = 0;
+
+    for(uint32_t quirks = MODERN_QUIRKS; quirks <= SCHIP_QUIRKS; quirks++) {
+        for(SimdLevel level : {SIMD_SCALAR, SIMD_AVX2}) {
+            for(uint32_t clock : {CHIP8_DEFAULT_CLOCK, 37u}) {
+                //Not a whole number of blocks, so the last one is partial
+                std::vector<Rom> machines;
+                for(uint32_t i = 0; i < BATCH_BLOCK + 7; i++) {
+                    machines.push_back(roms[i % roms.size()]);
+                }
+
+                failures += compareBatch("roms", machines, static_cast<QuirkProfile>(quirks), level, clock, {});
+
+                //A stack overflow in one machine must not reach the ones next to it
+                machines[9] = runaway;
+                failures += compareBatch("runaway call", machines, static_cast<QuirkProfile>(quirks), level, clock, {9});
+            }
+        }
+    }
+
+    return failures;
+}
+
+//A state goes through a file and carries on the same as the machine it came from, and a state
+//loaded a few pages at a time over an older one ends up the same as one loaded whole
+static uint32_t testState(const std::vector<Rom> &roms) {
+    uint32_t failures = 0;
+
+    for(const Rom &rom : roms) {
+        for(uint32_t quirks = MODERN_QUIRKS; quirks <= SCHIP_QUIRKS; quirks++) {
+            const std::string what = fmt::sprintf("%s quirks %d", rom.name, quirks);
+
+            Chip8 reference;
+            bootMachine(reference, rom, static_cast<QuirkProfile>(quirks), 1);
+
+            std::vector<uint16_t> keys(300);
+            uint64_t rng = seedRandom(quirks);
+            MachineState early, middle;
+
+            for(uint32_t frame = 0; frame < keys.size(); frame++) {
+                if(frame == 100) { early = savedState(reference); }
+                if(frame == 200) { middle = savedState(reference); }
+
+                keys[frame] = randomKeys(rng);
+                runFrame(reference, keys[frame]);
+            }
+
+            const MachineState end = savedState(reference);
+
+            std::vector<uint8_t> data = serializeState(middle);
+            MachineState restored;
+            memset(&restored, 0, sizeof(restored));
+
+            if(deserializeState(data.data(), data.size(), restored) != OK) {
+                fmt::printf("FAIL %s: state file doesn't load\n", what);
+                failures++;
+                continue;
+            }
+
+            failures += expectSame(middle, restored, what + " file");
+
+            if(deserializeState(data.data(), data.size() - 1, restored) != INVALID_STATE) {
+                fmt::printf("FAIL %s: cut off state file loads\n", what);
+                failures++;
+            }
+
+            Chip8 loaded;
+            bootMachine(loaded, rom, static_cast<QuirkProfile>(quirks), 2);
+            loaded.loadState(restored);
+
+            //Over the early state only the pages that differ are loaded
+            uint32_t pages = 0;
+            for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+                if(memcmp(&early.mem[page * CHIP8_PAGE_SIZE], &middle.mem[page * CHIP8_PAGE_SIZE], CHIP8_PAGE_SIZE) != 0) { pages |= 1u << page; }
+            }
+
+            Chip8 partial;
+            bootMachine(partial, rom, static_cast<QuirkProfile>(quirks), 3);
+            partial.loadState(early);
+            partial.loadState(middle, pages);
+            failures += expectSame(middle, savedState(partial), what + " page load");
+
+            for(uint32_t frame = 200; frame < keys.size(); frame++) {
+                runFrame(loaded, keys[frame]);
+                runFrame(partial, keys[frame]);
+            }
+
+            failures += expectSame(end, savedState(loaded), what + " after file");
+            failures += expectSame(end, savedState(partial), what + " after page load");
+
+            //Saving some pages leaves the rest of the state's memory alone
+            const uint32_t odd_pages = CHIP8_ALL_PAGES & 0xaaaaaaaa;
+            MachineState some;
+            memset(&some, 0x5a, sizeof(some));
+            reference.saveState(some, odd_pages);
+
+            for(uint32_t page = 0; page < CHIP8_MEM_PAGES; page++) {
+                const uint8_t *saved = &some.mem[page * CHIP8_PAGE_SIZE];
+                bool same = (odd_pages >> page) & 1 ? memcmp(saved, &end.mem[page * CHIP8_PAGE_SIZE], CHIP8_PAGE_SIZE) == 0
+                                                    : std::all_of(saved, saved + CHIP8_PAGE_SIZE, [](uint8_t b) { return b == 0x5a; });
+
+                if(!same) {
+                    fmt::printf("FAIL %s: page %u saved wrong\n", what, page);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    return failures;
+}
+
+//Rewinding gives back every recorded frame newest first, across keyframe groups, including
+//frames recorded again after rewinding part of the way
+static uint32_t testRewind(const std::vector<Rom> &roms) {
+    static constexpr uint32_t CAPACITY = 200;
+    static constexpr uint32_t KEYFRAME_INTERVAL = 7;
+
+    uint32_t failures = 0;
+
+    for(const Rom &rom : roms) {
+        Chip8 emu;
+        bootMachine(emu, rom, MODERN_QUIRKS, 1);
+        emu.setRewindLength(CAPACITY, KEYFRAME_INTERVAL);
+
+        std::vector<MachineState> history(300);
+        uint64_t rng = seedRandom(2);
+
+        for(uint32_t frame = 0; frame < history.size(); frame++) {
+            history[frame] = savedState(emu);
+            emu.recordRewindFrame();
+            runFrame(emu, randomKeys(rng));
+        }
+
+        //Whole groups are dropped, so up to a group less than the capacity is held
+        if(emu.getRewindFrameCount() > CAPACITY || emu.getRewindFrameCount() + KEYFRAME_INTERVAL <= CAPACITY) {
+            fmt::printf("FAIL %s: %u frames held, expected up to %u\n", rom.name, emu.getRewindFrameCount(), CAPACITY);
+            failures++;
+        }
+
+        //Back 50 frames, then 20 new ones over them
+        uint32_t frame = static_cast<uint32_t>(history.size());
+        for(uint32_t i = 0; i < 50; i++) {
+            frame--;
+            if(!emu.rewindFrame()) { break; }
+            failures += expectSame(history[frame], savedState(emu), fmt::sprintf("%s rewind to frame %u", rom.name, frame));
+        }
+
+        for(uint32_t i = 0; i < 20; i++, frame++) {
+            history[frame] = savedState(emu);
+            emu.recordRewindFrame();
+            runFrame(emu, randomKeys(rng));
+        }
+
+        //Everything that is left, down to the oldest frame still held
+        const uint32_t oldest = frame - emu.getRewindFrameCount();
+        while(frame > oldest) {
+            frame--;
+            if(!emu.rewindFrame()) {
+                fmt::printf("FAIL %s: ran out of frames at %u\n", rom.name, frame);
+                failures++;
+                break;
+            }
+
+            failures += expectSame(history[frame], savedState(emu), fmt::sprintf("%s rewind again to frame %u", rom.name, frame));
+        }
+
+        if(emu.rewindFrame()) {
+            fmt::printf("FAIL %s: rewound past the oldest frame\n", rom.name);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+//How many cycles idle skipping saved depends on how a run was split into calls to cycle, which
+//a movie doesn't keep, so states that went through one are compared without it
+static MachineState playedState(const Chip8 &emu) {
+    MachineState state = savedState(emu);
+    state.idle_cycles = 0;
+    return state;
+}
+
+//A movie played back ends where the recording did, and seeking lands on the same state the
+//recording passed through at that cycle, backwards as well as forwards
+static uint32_t testMovie(const std::vector<Rom> &roms) {
+    uint32_t failures = 0;
+
+    for(const Rom &rom : roms) {
+        Chip8 reference;
+        bootMachine(reference, rom, CHIP48_QUIRKS, 1);
+
+        //The recording starts part way into the run
+        uint64_t rng = seedRandom(3);
+        for(uint32_t frame = 0; frame < 30; frame++) {
+            runFrame(reference, randomKeys(rng));
+        }
+
+        MovieRecorder recorder;
+        recorder.start(reference, 1000);
+
+        std::vector<MachineState> states(300);
+        bool keys[CHIP8_NUM_KEYS];
+
+        for(uint32_t frame = 0; frame < states.size(); frame++) {
+            states[frame] = playedState(reference);
+            unpackKeys(randomKeys(rng), keys);
+            recorder.update(reference, keys);
+            reference.cycle(FRAME, keys);
+        }
+
+        const MachineState end = playedState(reference);
+        std::vector<uint8_t> data = serializeMovie(recorder.stop(reference));
+
+        Movie movie;
+        if(deserializeMovie(data.data(), data.size(), movie) != OK) {
+            fmt::printf("FAIL %s: movie file doesn't load\n", rom.name);
+            failures++;
+            continue;
+        }
+
+        //Booted differently, everything that matters comes from the movie
+        Chip8 emu;
+        bootMachine(emu, rom, MODERN_QUIRKS, 2);
+
+        MoviePlayer player;
+        if(player.start(emu, movie) != OK) {
+            fmt::printf("FAIL %s: movie doesn't play\n", rom.name);
+            failures++;
+            continue;
+        }
+
+        failures += expectSame(states[0], playedState(emu), rom.name + " movie start");
+
+        while(player.run(emu, 1000) > 0) { }
+        failures += expectSame(end, playedState(emu), rom.name + " movie end");
+
+        for(uint32_t frame : {150u, 7u, 299u, 0u, 123u}) {
+            player.seek(emu, states[frame].cycles);
+            failures += expectSame(states[frame], playedState(emu), fmt::sprintf("%s seek to frame %u", rom.name, frame));
+        }
+    }
+
+    return failures;
+}
+
+//States forked from each other run the same as whole machines, and running one never changes
+//what the others hold even though they share pages
+static uint32_t testFork(const std::vector<Rom> &roms) {
+    uint32_t failures = 0;
+
+    for(const Rom &rom : roms) {
+        Chip8 reference;
+        bootMachine(reference, rom, MODERN_QUIRKS, 1);
+
+        uint64_t rng = seedRandom(4);
+        for(uint32_t frame = 0; frame < 60; frame++) {
+            runFrame(reference, randomKeys(rng));
+        }
+
+        const MachineState root_state = savedState(reference);
+
+        Searcher searcher;
+        ForkState root = searcher.capture(reference);
+
+        //Two siblings and, half way, a child of the first, each next to a whole machine
+        std::vector<ForkState> forks = {root.fork(), root.fork()};
+        std::vector<Chip8> machines(3);
+        for(uint32_t i = 0; i < 2; i++) {
+            bootMachine(machines[i], rom, MODERN_QUIRKS, 1);
+            machines[i].loadState(root_state);
+        }
+
+        for(uint32_t frame = 0; frame < 120; frame++) {
+            if(frame == 60) {
+                forks.push_back(forks[0].fork());
+                bootMachine(machines[2], rom, MODERN_QUIRKS, 1);
+                machines[2].loadState(savedState(machines[0]));
+            }
+
+            for(uint32_t i = 0; i < forks.size(); i++) {
+                bool keys[CHIP8_NUM_KEYS];
+                unpackKeys(randomKeys(rng), keys);
+                searcher.run(forks[i], FRAME, keys);
+                machines[i].cycle(FRAME, keys);
+            }
+        }
+
+        Chip8 check;
+        for(uint32_t i = 0; i < forks.size(); i++) {
+            searcher.restore(forks[i], check);
+            failures += expectSame(savedState(machines[i]), savedState(check), fmt::sprintf("%s fork %u", rom.name, i));
+        }
+
+        searcher.restore(root, check);
+        failures += expectSame(root_state, savedState(check), rom.name + " root");
+    }
+
+    return failures;
+}
+
+//The interpreter, threaded and JIT cores stay in step with each other all the way
+static uint32_t testCores(const std::vector<Rom> &roms) {
+    static const CoreType cores[] = {INTERPRETER_CORE, THREADED_CORE, JIT_CORE};
+
+    uint32_t failures = 0;
+
+    for(const Rom &rom : roms) {
+        for(uint32_t quirks = MODERN_QUIRKS; quirks <= SCHIP_QUIRKS; quirks++) {
+            std::vector<Chip8> machines(std::size(cores));
+            for(uint32_t i = 0; i < machines.size(); i++) {
+                machines[i].setCore(cores[i]);
+                bootMachine(machines[i], rom, static_cast<QuirkProfile>(quirks), 1);
+            }
+
+            uint64_t rng = seedRandom(5);
+
+            for(uint32_t frame = 1; frame <= 300; frame++) {
+                uint16_t keys = randomKeys(rng);
+                for(Chip8 &emu : machines) {
+                    runFrame(emu, keys);
+                }
+
+                //Checked now and then so a difference is caught close to where it started
+                if(frame % 30 != 0) { continue; }
+
+                uint32_t differ = 0;
+                for(uint32_t i = 1; i < machines.size(); i++) {
+                    differ += expectSame(savedState(machines[0]), savedState(machines[i]), fmt::sprintf("%s quirks %d core %d frame %u", rom.name, quirks, cores[i], frame));
+                }
+
+                failures += differ;
+                if(differ > 0) { break; }
+            }
+        }
+    }
+
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    using Group = uint32_t(*)(const std::vector<Rom> &roms);
+    static const std::pair<const char*, Group> groups[] = {
+        {"batch", testBatch}, {"state", testState}, {"rewind", testRewind}, {"movie", testMovie}, {"fork", testFork}, {"cores", testCores}
+    };
+
+    if(argc < 3) {
+        fmt::printf("Usage: %s <group> <roms directory>\n\nGroups: batch, state, rewind, movie, fork, cores\n", argv[0]);
+        return 1;
+    }
+
+    const std::string group = argv[1];
+    auto found = std::find_if(std::begin(groups), std::end(groups), [&](const auto &entry) { return group == entry.first; });
+
+    if(found == std::end(groups)) {
+        fmt::printf("Unknown group %s\n", group);
+        return 1;
+    }
+
+    std::vector<Rom> roms = loadRoms(argv[2]);
+    uint32_t failures = roms.empty() ? 1 : found->second(roms);
+
+    fmt::printf("%s: %u failures\n", group, failures);
+    return failures == 0 ? 0 : 1;
+}